@@ -0,0 +1,372 @@
+/**
+ * @file binary_format.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/binary_format.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+#include "invport/detail/parallel.h"
+
+namespace inv::binary
+{
+namespace
+{
+using Transaction = detail::Transaction;
+
+constexpr char kMagic[4] = {'I', 'N', 'V', 'H'};
+constexpr uint32_t kNoString = std::numeric_limits<uint32_t>::max();
+
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t checksum;
+  uint64_t num_blocks;
+  uint64_t num_records;
+  uint64_t num_tags;
+  uint64_t num_strings;
+  uint32_t num_symbols;      // Strings [0, num_symbols) are symbols.
+  uint32_t num_tag_strings;  // The next num_tag_strings strings are tag keys and values.
+};
+
+static_assert(sizeof(Header) == 56);
+static_assert(sizeof(Record) == 48);
+static_assert(sizeof(TagRecord) == 8);
+
+/**
+ * Assigns each distinct string an index in the string table.
+ */
+class StringTable
+{
+ public:
+  uint32_t Add(std::string_view str)
+  {
+    const auto [it, inserted] = indices_.emplace(str, static_cast<uint32_t>(offsets_.size() - 1));
+    if (inserted)
+    {
+      data_.append(str);
+      offsets_.push_back(data_.size());
+    }
+    return it->second;
+  }
+
+  /**
+   * Appends the strings of another table, whose indices are then offset by the size of this one.
+   */
+  void Append(const StringTable& other)
+  {
+    const auto base = data_.size();
+    for (auto it = other.offsets_.begin() + 1; it != other.offsets_.end(); ++it) offsets_.push_back(base + *it);
+    data_.append(other.data_);
+  }
+
+  [[nodiscard]] std::size_t Size() const noexcept { return offsets_.size() - 1; }
+
+  /**
+   * Returns the offsets and the data, which no longer need the strings that were added to stay alive.
+   */
+  std::pair<std::vector<uint64_t>, std::string> Release() &&
+  {
+    indices_.clear();
+    return {std::move(offsets_), std::move(data_)};
+  }
+
+ private:
+  std::unordered_map<std::string_view, uint32_t> indices_;
+  std::vector<uint64_t> offsets_{0};
+  std::string data_;
+};
+
+template <typename T>
+std::string_view Bytes(const T* values, std::size_t count)
+{
+  return {reinterpret_cast<const char*>(values), sizeof(T) * count};
+}
+
+template <typename T>
+T Load(const char* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+/**
+ * Returns the number of bytes needed for count elements of type T, or throws if it would not fit in the data.
+ */
+template <typename T>
+std::size_t SectionSize(uint64_t count, std::size_t remaining)
+{
+  if (count > remaining / sizeof(T)) throw std::runtime_error("file is truncated");
+  return count * sizeof(T);
+}
+
+/**
+ * Returns the number of checksum blocks that cover the given number of bytes.
+ */
+std::size_t NumBlocks(std::size_t size) { return (size + kChecksumBlockBytes - 1) / kChecksumBlockBytes; }
+}  // namespace
+
+ValueWithErrorCode<Snapshot> Snapshot::Factory(const detail::Timeline& timeline)
+{
+  Snapshot snapshot;
+  StringTable symbols;
+  StringTable tag_strings;
+  StringTable comments;
+  snapshot.records_.reserve(timeline.size());
+
+  for (const auto& [date, ids] : timeline)
+  {
+    for (const auto id : ids)
+    {
+      const auto* tr = TransactionPool::Find(id);
+      if (tr == nullptr)
+        return {{}, ErrorCode("binary::Snapshot::Factory() failed", {"id", ErrorCode(std::to_string(id))})};
+
+      Record record{};
+      record.price = tr->price.ToRaw();
+      record.quantity = tr->quantity.ToRaw();
+      record.fee = tr->fee.ToRaw();
+      record.symbol = symbols.Add(tr->symbol.Get());
+      record.comment = comments.Add(tr->comment);
+      record.tags_begin = static_cast<uint32_t>(snapshot.tags_.size());
+      record.tags_count = tr->tags.Size();
+      record.date = date.ToPrimitive();
+      record.type = static_cast<uint8_t>(tr->type);
+      snapshot.records_.push_back(record);
+
+      for (const auto& tag : tr->tags)
+        snapshot.tags_.push_back(
+            {tag_strings.Add(tag.Key()), tag.HasValue() ? tag_strings.Add(tag.Value()) : kNoString});
+    }
+  }
+
+  // The strings of each role follow those of the previous one.
+  snapshot.num_symbols_ = static_cast<uint32_t>(symbols.Size());
+  snapshot.num_tag_strings_ = static_cast<uint32_t>(tag_strings.Size());
+  const auto comments_base = snapshot.num_symbols_ + snapshot.num_tag_strings_;
+  for (auto& tag : snapshot.tags_)
+  {
+    tag.key += snapshot.num_symbols_;
+    if (tag.value != kNoString) tag.value += snapshot.num_symbols_;
+  }
+  for (auto& record : snapshot.records_) record.comment += comments_base;
+
+  symbols.Append(tag_strings);
+  symbols.Append(comments);
+  std::tie(snapshot.offsets_, snapshot.strings_) = std::move(symbols).Release();
+  return {std::move(snapshot), {}};
+}
+
+ValueWithErrorCode<uint64_t> Snapshot::Write(std::ostream& out) const
+{
+  const auto sections = {Bytes(records_.data(), records_.size()), Bytes(tags_.data(), tags_.size()),
+                         Bytes(offsets_.data(), offsets_.size()), std::string_view(strings_)};
+
+  // Blocks span sections, so each hash is carried over into the next section.
+  std::vector<uint64_t> blocks;
+  uint64_t hash = Fnv1a({});
+  std::size_t filled = 0;
+  for (auto section : sections)
+  {
+    while (!section.empty())
+    {
+      const auto piece = section.substr(0, kChecksumBlockBytes - filled);
+      hash = Fnv1a(piece, hash);
+      filled += piece.size();
+      section.remove_prefix(piece.size());
+      if (filled == kChecksumBlockBytes)
+      {
+        blocks.push_back(hash);
+        hash = Fnv1a({});
+        filled = 0;
+      }
+    }
+  }
+  if (filled > 0) blocks.push_back(hash);
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.checksum = Fnv1a(Bytes(blocks.data(), blocks.size()));
+  header.num_blocks = blocks.size();
+  header.num_records = records_.size();
+  header.num_tags = tags_.size();
+  header.num_strings = offsets_.size() - 1;
+  header.num_symbols = num_symbols_;
+  header.num_tag_strings = num_tag_strings_;
+
+  const auto header_bytes = Bytes(&header, 1);
+  out.write(header_bytes.data(), static_cast<std::streamsize>(header_bytes.size()));
+  const auto blocks_bytes = Bytes(blocks.data(), blocks.size());
+  out.write(blocks_bytes.data(), static_cast<std::streamsize>(blocks_bytes.size()));
+  for (const auto section : sections) out.write(section.data(), static_cast<std::streamsize>(section.size()));
+  if (!out) return {0, ErrorCode("binary::Snapshot::Write() failed")};
+
+  return {header.checksum, {}};
+}
+
+void Snapshot::WriteJson(detail::JsonWriter& writer) const
+{
+  std::vector<Transaction::TagView> tags;
+  writer.BeginArray();
+  for (const auto& record : records_)
+  {
+    tags.clear();
+    for (uint32_t t = record.tags_begin; t < record.tags_begin + record.tags_count; ++t)
+    {
+      const auto& tag = tags_[t];
+      tags.emplace_back(String(tag.key), tag.value == kNoString ? std::nullopt : std::optional(String(tag.value)));
+    }
+
+    Transaction::Serialize(writer, Date(record.date), String(record.symbol),
+                           static_cast<Transaction::Type>(record.type), Price::FromRaw(record.price),
+                           Transaction::Quantity::FromRaw(record.quantity), Price::FromRaw(record.fee), tags,
+                           String(record.comment));
+  }
+  writer.EndArray();
+}
+
+std::string_view Snapshot::String(const uint32_t index) const
+{
+  return std::string_view(strings_).substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+}
+
+ValueWithErrorCode<std::string> Encode(const detail::Timeline& timeline)
+{
+  auto [snapshot, ec] = Snapshot::Factory(timeline);
+  if (ec.Failure()) return {{}, ErrorCode("binary::Encode() failed", std::move(ec))};
+
+  std::ostringstream out;
+  if (auto written = snapshot.Write(out); written.second.Failure())
+    return {{}, ErrorCode("binary::Encode() failed", std::move(written.second))};
+  return {std::move(out).str(), {}};
+}
+
+ValueWithErrorCode<Entries> Decode(std::string_view data, std::size_t min_chunk_records)
+{
+  std::vector<Transaction::ID> ids;
+  Entries entries;
+  try
+  {
+    if (data.size() < sizeof(Header)) throw std::runtime_error("file is truncated");
+    const auto header = Load<Header>(data.data());
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) throw std::runtime_error("not a transaction history");
+    if (header.version != kVersion) throw std::runtime_error("unsupported version " + std::to_string(header.version));
+
+    // Each block is hashed independently, so the blocks are verified on a thread per chunk of them.
+    const char* blocks_data = data.data() + sizeof(Header);
+    const auto blocks_size = SectionSize<uint64_t>(header.num_blocks, data.size() - sizeof(Header));
+    const auto body = data.substr(sizeof(Header) + blocks_size);
+    if (header.num_blocks != NumBlocks(body.size())) throw std::runtime_error("invalid number of checksum blocks");
+    if (Fnv1a(std::string_view(blocks_data, blocks_size)) != header.checksum)
+      throw std::runtime_error("checksum mismatch");
+    const auto verified = detail::ParallelChunks(header.num_blocks, 1, [&](std::size_t begin, std::size_t end) {
+      for (auto i = begin; i < end; ++i)
+      {
+        const auto block = body.substr(i * kChecksumBlockBytes, kChecksumBlockBytes);
+        if (Fnv1a(block) != Load<uint64_t>(blocks_data + sizeof(uint64_t) * i)) return false;
+      }
+      return true;
+    });
+    if (std::find(verified.begin(), verified.end(), false) != verified.end())
+      throw std::runtime_error("checksum mismatch");
+
+    std::size_t remaining = body.size();
+    const char* records_data = body.data();
+    const auto records_size = SectionSize<Record>(header.num_records, remaining);
+    remaining -= records_size;
+    const char* tags_data = records_data + records_size;
+    const auto tags_size = SectionSize<TagRecord>(header.num_tags, remaining);
+    remaining -= tags_size;
+    const char* offsets_data = tags_data + tags_size;
+    if (header.num_strings >= kNoString) throw std::runtime_error("too many strings");
+    const auto offsets_size = SectionSize<uint64_t>(header.num_strings + 1, remaining);
+    remaining -= offsets_size;
+    const char* strings_data = offsets_data + offsets_size;
+
+    std::vector<std::string_view> strings;
+    strings.reserve(header.num_strings);
+    for (uint64_t i = 0, begin = Load<uint64_t>(offsets_data); i < header.num_strings; ++i)
+    {
+      const auto end = Load<uint64_t>(offsets_data + sizeof(uint64_t) * (i + 1));
+      if (begin > end || end > remaining) throw std::runtime_error("invalid string offset");
+      strings.emplace_back(strings_data + begin, end - begin);
+      begin = end;
+    }
+
+    // Interning mutates process-wide tables, so the symbols and tags are interned here, and the workers below only
+    // read the resulting IDs. They are grouped in the string table, so this is a pass over the distinct strings alone.
+    const uint64_t tags_end = uint64_t{header.num_symbols} + header.num_tag_strings;
+    if (tags_end > header.num_strings) throw std::runtime_error("invalid string roles");
+    std::vector<SymbolTable::SymbolID> symbol_ids;
+    std::vector<Transaction::Tags::TagID> tag_ids;
+    symbol_ids.reserve(header.num_symbols);
+    tag_ids.reserve(header.num_tag_strings);
+    for (uint32_t i = 0; i < header.num_symbols; ++i) symbol_ids.push_back(SymbolTable::Intern(strings[i]));
+    for (auto i = header.num_symbols; i < tags_end; ++i) tag_ids.push_back(Transaction::Tags::Intern(strings[i]));
+
+    const auto get_tag = [&](uint32_t index) {
+      if (index == kNoString) return Transaction::Tags::kNoValue;
+      if (index < header.num_symbols || index >= tags_end) throw std::runtime_error("invalid tag string index");
+      return tag_ids[index - header.num_symbols];
+    };
+
+    // Records are fixed-width, so they are split into chunks that are validated and created in the pool on separate
+    // threads, each into IDs reserved for them in advance.
+    ids = TransactionPool::Reserve(header.num_records);
+    entries.resize(header.num_records);
+    detail::ParallelChunks(header.num_records, min_chunk_records, [&](std::size_t begin, std::size_t end) {
+      Date::PrimitiveType last_date = begin == 0 ? 0 : Load<Record>(records_data + sizeof(Record) * (begin - 1)).date;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const auto record = Load<Record>(records_data + sizeof(Record) * i);
+        if (record.date < last_date) throw std::runtime_error("records are not in date order");
+        if (record.type > Transaction::Type::SELL) throw std::runtime_error("invalid transaction type");
+        if (record.symbol >= header.num_symbols) throw std::runtime_error("invalid symbol string index");
+        if (record.comment >= strings.size()) throw std::runtime_error("invalid comment string index");
+        if (record.tags_begin > header.num_tags || record.tags_count > header.num_tags - record.tags_begin)
+          throw std::runtime_error("invalid tag range");
+        last_date = record.date;
+
+        Transaction::Tags tags;
+        for (uint32_t t = 0; t < record.tags_count; ++t)
+        {
+          const auto tag = Load<TagRecord>(tags_data + sizeof(TagRecord) * (record.tags_begin + t));
+          if (tag.key == kNoString) throw std::runtime_error("invalid tag key");
+          tags.Add(get_tag(tag.key), get_tag(tag.value));
+        }
+
+        TransactionPool::CreateReserved(ids[i], Date(record.date), InternedSymbol::FromId(symbol_ids[record.symbol]),
+                                        static_cast<Transaction::Type>(record.type), Price::FromRaw(record.price),
+                                        Transaction::Quantity::FromRaw(record.quantity), Price::FromRaw(record.fee),
+                                        std::move(tags), Transaction::Comment(strings[record.comment]));
+        entries[i] = {record.date, ids[i]};
+      }
+      return end - begin;
+    });
+  }
+  catch (const std::exception& e)
+  {
+    for (const auto id : ids) TransactionPool::Unreserve(id);
+    return {{}, ErrorCode("binary::Decode() failed", ErrorCode(e.what()))};
+  }
+
+  return {std::move(entries), {}};
+}
+
+uint64_t Checksum(std::string_view data)
+{
+  return data.size() < sizeof(Header) ? 0 : Load<Header>(data.data()).checksum;
+}
+}  // namespace inv::binary
@@ -0,0 +1,142 @@
+/**
+ * @file binary_format.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "invport/detail/common.h"
+#include "invport/detail/json_writer.h"
+#include "invport/detail/timeline.h"
+#include "invport/detail/transaction.h"
+
+/**
+ * Contains the compact binary format for transaction histories.
+ *
+ * A file is a header followed by five sections:
+ *   1. Block checksums: the Fnv1a hash of each kChecksumBlockBytes of the sections after them
+ *   2. Transaction records: fixed-width, in date order
+ *   3. Tag records: (key, value) string indices, referenced by transaction records as a contiguous range
+ *   4. String offsets: one more than the number of strings, so string i spans [offsets[i], offsets[i + 1])
+ *   5. String data: every distinct symbol, then every distinct tag key and value, then every distinct comment
+ *
+ * Numbers are stored in native byte order. Prices, quantities and fees are stored as the raw integers of their
+ * decimals. The version is bumped whenever the layout changes.
+ *
+ * Loading a file is a bounds check per record plus one interning per distinct symbol and tag, with no per-field text
+ * parsing. Blocks are verified and records are decoded on a thread per chunk, and as the strings are grouped by role,
+ * only the interning has to happen on a single thread.
+ */
+namespace inv::binary
+{
+using Entries = std::vector<std::pair<Date::PrimitiveType, detail::Transaction::ID>>;
+
+constexpr uint32_t kVersion = 1;
+
+/**
+ * The number of bytes covered by each block checksum, except the last, which covers the rest.
+ */
+constexpr std::size_t kChecksumBlockBytes = 1 << 20;
+
+/**
+ * The minimum number of records per decoding thread, so that small files are decoded on the calling thread alone.
+ */
+constexpr std::size_t kMinChunkRecords = 16384;
+
+struct Record
+{
+  Price::Raw price;
+  detail::Transaction::Quantity::Raw quantity;
+  Price::Raw fee;
+  uint32_t symbol;
+  uint32_t comment;
+  uint32_t tags_begin;
+  uint32_t tags_count;
+  Date::PrimitiveType date;
+  uint8_t type;
+  uint8_t reserved[5];
+};
+
+struct TagRecord
+{
+  uint32_t key;
+  uint32_t value;
+};
+
+/**
+ * A copy of a timeline's transactions laid out as the sections of a file, which refers to neither the TransactionPool
+ * nor the symbol and tag tables. It can therefore be written on another thread while they change, and it takes about as
+ * much memory as the binary file.
+ */
+class Snapshot
+{
+ public:
+  /**
+   * Copies the transactions of the given timeline.
+   * @param timeline the timeline to copy
+   * @return Snapshot if success and ErrorCode denoting success or failure
+   */
+  static ValueWithErrorCode<Snapshot> Factory(const detail::Timeline& timeline);
+
+  /**
+   * Writes the snapshot in the binary format. The block checksums are computed from the sections before any of them is
+   * written, so the sections are written straight from the snapshot, with no copy of the file in memory.
+   * @param out the stream to write to
+   * @return the checksum that Checksum() returns for the written contents and ErrorCode denoting success or failure
+   */
+  ValueWithErrorCode<uint64_t> Write(std::ostream& out) const;
+
+  /**
+   * Writes the snapshot as the JSON array of transaction objects that TransactionHistory::Serialize() writes. The
+   * caller flushes the writer.
+   * @param writer the writer to write to
+   */
+  void WriteJson(detail::JsonWriter& writer) const;
+
+ private:
+  [[nodiscard]] std::string_view String(uint32_t index) const;
+
+  std::vector<Record> records_;
+  std::vector<TagRecord> tags_;
+  std::vector<uint64_t> offsets_;
+  std::string strings_;
+  uint32_t num_symbols_ = 0;
+  uint32_t num_tag_strings_ = 0;
+};
+
+/**
+ * Encodes the transactions of the given timeline.
+ * @param timeline the timeline to encode
+ * @return encoded file contents if success and ErrorCode denoting success or failure
+ */
+ValueWithErrorCode<std::string> Encode(const detail::Timeline& timeline);
+
+/**
+ * Decodes file contents, creating each transaction in the TransactionPool. If decoding fails, including when the
+ * contents do not match their checksums, no transactions are left in the pool.
+ *
+ * The block checksums are verified on a thread per chunk of blocks. After the symbols and tags are interned, IDs for
+ * every record are reserved in the pool, and the records are split into chunks that are validated and created in the
+ * pool on a thread each.
+ * @param data encoded file contents
+ * @param min_chunk_records the minimum number of records per thread
+ * @return (date, id) pairs of the new transactions in date order and ErrorCode denoting success or failure
+ */
+ValueWithErrorCode<Entries> Decode(std::string_view data, std::size_t min_chunk_records = kMinChunkRecords);
+
+/**
+ * Returns the checksum stored in the header of the given file contents, which is the Fnv1a hash of the block
+ * checksums. It identifies the contents without having to hash them, and Decode() verifies it. Returns zero if the
+ * contents are too short to have a header.
+ */
+uint64_t Checksum(std::string_view data);
+}  // namespace inv::binary
@@ -10,6 +10,8 @@
 #include <iex/detail/json_serializer.h>
 #include <iex/iex.h>
 
+#include "invport/detail/decimal.h"
+
 namespace inv
 {
 using ErrorCode = iex::ErrorCode;
@@ -22,5 +24,8 @@ using Timestamp = iex::Timestamp;
 namespace json = iex::json;  // NOLINT For some reason it doesn't think this is being used.
 
 using Symbol = iex::Symbol;
-using Price = iex::Price;
+/**
+ * An amount of money, such as a price or a fee, to a hundredth of a cent.
+ */
+using Price = Decimal<4>;
 }  // namespace inv
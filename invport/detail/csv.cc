@@ -0,0 +1,41 @@
+/**
+ * @file csv.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/csv.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace inv::detail
+{
+std::size_t SplitFields(std::string_view line, std::string_view* fields, std::size_t max_fields, char delimiter)
+{
+  std::size_t count = 0;
+  std::size_t field_begin = 0;
+  const auto end_field = [&](std::size_t end) {
+    if (count < max_fields) fields[count] = line.substr(field_begin, end - field_begin);
+    ++count;
+    field_begin = end + 1;
+  };
+
+  std::size_t i = 0;
+#ifdef __SSE2__
+  const __m128i needle = _mm_set1_epi8(delimiter);
+  for (; i + sizeof(__m128i) <= line.size(); i += sizeof(__m128i))
+  {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line.data() + i));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    for (; mask != 0; mask &= mask - 1) end_field(i + __builtin_ctz(mask));
+  }
+#endif
+  for (; i < line.size(); ++i)
+    if (line[i] == delimiter) end_field(i);
+
+  end_field(line.size());
+  return count;
+}
+}  // namespace inv::detail
@@ -0,0 +1,26 @@
+/**
+ * @file csv.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace inv::detail
+{
+/**
+ * Splits a line of delimiter-separated values into fields, without copying them.
+ *
+ * Delimiters are found 16 bytes at a time with SSE2 where it is available, and one byte at a time otherwise. Quoting is
+ * not supported, as broker exports do not quote their fields.
+ * @param line the line, without its newline
+ * @param fields the array to store views of the fields in, which point into line
+ * @param max_fields the size of fields. Fields past it are counted, but not stored.
+ * @param delimiter the character that separates fields
+ * @return the number of fields in the line, which is one more than the number of delimiters
+ */
+std::size_t SplitFields(std::string_view line, std::string_view* fields, std::size_t max_fields, char delimiter = ',');
+}  // namespace inv::detail
@@ -0,0 +1,268 @@
+/**
+ * @file decimal.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace inv
+{
+namespace detail
+{
+constexpr int64_t Pow10(unsigned exponent)
+{
+  int64_t power = 1;
+  while (exponent-- > 0) power *= 10;
+  return power;
+}
+
+__extension__ typedef __int128 Int128;  // NOLINT The extension keeps -pedantic quiet.
+}  // namespace detail
+
+/**
+ * A signed decimal number with a fixed number of fractional digits, stored as a 64-bit count of its smallest unit.
+ *
+ * Unlike floating point numbers, decimals add and subtract exactly, so sums do not depend on the order of their terms,
+ * and may be split across threads while producing identical results. Arithmetic that would overflow throws
+ * std::overflow_error instead of wrapping around. Floating point numbers, products, and parsed digits past the last
+ * fractional digit are rounded to the nearest unit, with ties away from zero.
+ * @tparam kDigits the number of fractional digits
+ */
+template <unsigned kDigits>
+class Decimal
+{
+ public:
+  using Raw = int64_t;
+
+  static_assert(kDigits <= 18, "the scale must fit in 64 bits");
+
+  /**
+   * The number of units in one.
+   */
+  static constexpr const Raw kScale = detail::Pow10(kDigits);
+
+  /**
+   * The maximum number of characters of a formatted decimal: a sign, 19 digits and a decimal point.
+   */
+  static constexpr const std::size_t kMaxChars = 21;
+
+  constexpr Decimal() noexcept = default;
+
+  /**
+   * Rounds a floating point number to the nearest unit. Implicit, so that decimals can be written as literals.
+   * Throws std::overflow_error if it is out of range or not a number.
+   */
+  constexpr Decimal(double value) : raw_(Round(value)) {}  // NOLINT
+
+  [[nodiscard]] static constexpr Decimal FromRaw(Raw raw) noexcept
+  {
+    Decimal decimal;
+    decimal.raw_ = raw;
+    return decimal;
+  }
+
+  /**
+   * Returns the number of units, which is the decimal multiplied by kScale.
+   */
+  [[nodiscard]] constexpr Raw ToRaw() const noexcept { return raw_; }
+
+  /**
+   * Returns the nearest floating point number, which is exact for up to 15 significant digits.
+   */
+  [[nodiscard]] constexpr double ToDouble() const noexcept { return static_cast<double>(raw_) / kScale; }
+
+  explicit constexpr operator double() const noexcept { return ToDouble(); }
+
+  /**
+   * Parses an optional minus sign, digits and an optional fraction from the beginning of str, such as "-12.5", without
+   * allocating and exactly. Exponents are not supported.
+   * @return the end of the parsed decimal, with std::errc::invalid_argument if str does not start with one, or
+   * std::errc::result_out_of_range if it does not fit
+   */
+  static std::from_chars_result FromChars(std::string_view str, Decimal& value) noexcept
+  {
+    const auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+    const char* it = str.data();
+    const char* const end = str.data() + str.size();
+    const bool negative = it != end && *it == '-';
+    if (negative) ++it;
+
+    // The magnitude is accumulated as a negative number, so that the smallest Raw can be parsed too.
+    Raw raw = 0;
+    bool overflow = false;
+    const auto push = [&raw, &overflow](char digit) {
+      overflow |= __builtin_mul_overflow(raw, 10, &raw);
+      overflow |= __builtin_sub_overflow(raw, digit - '0', &raw);
+    };
+
+    const char* const int_begin = it;
+    for (; it != end && is_digit(*it); ++it) push(*it);
+    bool has_digits = it != int_begin;
+
+    unsigned fraction_digits = 0;
+    bool round_away = false;
+    if (it != end && *it == '.' && (has_digits || (it + 1 != end && is_digit(it[1]))))
+    {
+      for (++it; it != end && is_digit(*it); ++it, ++fraction_digits)
+      {
+        if (fraction_digits < kDigits)
+          push(*it);
+        else if (fraction_digits == kDigits)
+          round_away = *it >= '5';
+      }
+      has_digits = true;
+    }
+    if (!has_digits) return {str.data(), std::errc::invalid_argument};
+
+    for (; fraction_digits < kDigits; ++fraction_digits) push('0');
+    if (round_away) overflow |= __builtin_sub_overflow(raw, 1, &raw);
+    if (!negative) overflow |= __builtin_mul_overflow(raw, -1, &raw);
+    if (overflow) return {it, std::errc::result_out_of_range};
+
+    value.raw_ = raw;
+    return {it, std::errc()};
+  }
+
+  /**
+   * Formats the decimal into the given buffer, exactly and without allocating, such as "-12.5". Trailing zeros of the
+   * fraction are omitted, as is the decimal point of whole numbers. A buffer of kMaxChars always fits the decimal.
+   * @return the end of the formatted decimal, with std::errc::value_too_large if it does not fit
+   */
+  std::to_chars_result ToChars(char* first, char* last) const noexcept
+  {
+    // The magnitude is unsigned, so that the smallest Raw has one.
+    const auto magnitude = raw_ < 0 ? 0 - static_cast<uint64_t>(raw_) : static_cast<uint64_t>(raw_);
+    auto fraction = magnitude % kScale;
+
+    std::to_chars_result result{first, std::errc()};
+    if (raw_ < 0)
+    {
+      if (first == last) return {last, std::errc::value_too_large};
+      *result.ptr++ = '-';
+    }
+    result = std::to_chars(result.ptr, last, magnitude / kScale);
+    if (result.ec != std::errc() || fraction == 0) return result;
+
+    auto digits = kDigits;
+    for (; fraction % 10 == 0; fraction /= 10) --digits;
+    if (last - result.ptr <= static_cast<std::ptrdiff_t>(digits)) return {last, std::errc::value_too_large};
+    *result.ptr++ = '.';
+    for (auto i = digits; i-- > 0; fraction /= 10) result.ptr[i] = static_cast<char>('0' + fraction % 10);
+    result.ptr += digits;
+    return result;
+  }
+
+  [[nodiscard]] std::string ToString() const
+  {
+    std::array<char, kMaxChars> buffer{};
+    const auto result = ToChars(buffer.data(), buffer.data() + buffer.size());
+    return std::string(buffer.data(), result.ptr);
+  }
+
+  constexpr Decimal operator-() const
+  {
+    Raw raw = 0;
+    const bool overflow = __builtin_sub_overflow(Raw(0), raw_, &raw);
+    return FromRaw(Checked(overflow, raw));
+  }
+
+  constexpr Decimal& operator+=(Decimal other)
+  {
+    Raw raw = 0;
+    const bool overflow = __builtin_add_overflow(raw_, other.raw_, &raw);
+    raw_ = Checked(overflow, raw);
+    return *this;
+  }
+
+  constexpr Decimal& operator-=(Decimal other)
+  {
+    Raw raw = 0;
+    const bool overflow = __builtin_sub_overflow(raw_, other.raw_, &raw);
+    raw_ = Checked(overflow, raw);
+    return *this;
+  }
+
+  /**
+   * Multiplies by a decimal of any scale, such as a price by a quantity. The product has the scale of this decimal.
+   */
+  template <unsigned kOtherDigits>
+  constexpr Decimal& operator*=(Decimal<kOtherDigits> other)
+  {
+    constexpr auto kDivisor = Decimal<kOtherDigits>::kScale;
+    const auto product = static_cast<detail::Int128>(raw_) * other.ToRaw();
+    auto quotient = product / kDivisor;
+    const auto remainder = product % kDivisor;
+    if (2 * (remainder < 0 ? -remainder : remainder) >= kDivisor) quotient += product < 0 ? -1 : 1;
+    if (quotient < std::numeric_limits<Raw>::min() || quotient > std::numeric_limits<Raw>::max())
+      throw std::overflow_error("Decimal overflow");
+    raw_ = static_cast<Raw>(quotient);
+    return *this;
+  }
+
+  friend constexpr Decimal operator+(Decimal lhs, Decimal rhs) { return lhs += rhs; }
+  friend constexpr Decimal operator-(Decimal lhs, Decimal rhs) { return lhs -= rhs; }
+
+  template <unsigned kOtherDigits>
+  friend constexpr Decimal operator*(Decimal lhs, Decimal<kOtherDigits> rhs)
+  {
+    return lhs *= rhs;
+  }
+
+  friend constexpr bool operator==(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ == rhs.raw_; }
+  friend constexpr bool operator!=(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ != rhs.raw_; }
+  friend constexpr bool operator<(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ < rhs.raw_; }
+  friend constexpr bool operator>(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ > rhs.raw_; }
+  friend constexpr bool operator<=(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ <= rhs.raw_; }
+  friend constexpr bool operator>=(Decimal lhs, Decimal rhs) noexcept { return lhs.raw_ >= rhs.raw_; }
+
+  friend std::ostream& operator<<(std::ostream& os, Decimal decimal) { return os << decimal.ToString(); }
+
+ private:
+  static constexpr Raw Round(double value)
+  {
+    // Doubles at or above 2^52 are whole numbers, and adding a half to them could round to the next one.
+    constexpr double kWhole = 4503599627370496.0;
+    constexpr double kLimit = 9223372036854775808.0;  // 2^63, which is a double unlike the largest Raw.
+
+    const double scaled = value * kScale;
+    const double rounded = scaled >= kWhole || scaled <= -kWhole ? scaled : scaled < 0 ? scaled - 0.5 : scaled + 0.5;
+    if (!(rounded > -kLimit && rounded < kLimit)) throw std::overflow_error("Decimal out of range");
+    return static_cast<Raw>(rounded);
+  }
+
+  static constexpr Raw Checked(bool overflow, Raw raw)
+  {
+    if (overflow) throw std::overflow_error("Decimal overflow");
+    return raw;
+  }
+
+  Raw raw_ = 0;
+};
+
+/**
+ * Serializes a decimal as a JSON number. nlohmann::json finds it through argument-dependent lookup.
+ */
+template <typename BasicJson, unsigned kDigits>
+void to_json(BasicJson& json, Decimal<kDigits> decimal)  // NOLINT Named for nlohmann::json.
+{
+  json = decimal.ToDouble();
+}
+
+template <typename BasicJson, unsigned kDigits>
+void from_json(const BasicJson& json, Decimal<kDigits>& decimal)  // NOLINT Named for nlohmann::json.
+{
+  decimal = Decimal<kDigits>(json.template get<double>());
+}
+}  // namespace inv
@@ -0,0 +1,30 @@
+/**
+ * @file dictionary.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/dictionary.h"
+
+namespace inv::detail
+{
+Dictionary::Dictionary(std::initializer_list<std::string_view> reserved)
+{
+  for (const auto& str : reserved) Intern(str);
+}
+
+Dictionary::ID Dictionary::Intern(std::string_view str)
+{
+  if (const auto iter = ids_.find(str); iter != ids_.end()) return iter->second;
+
+  const auto id = static_cast<ID>(strings_.size());
+  ids_.emplace(strings_.emplace_back(str), id);
+  return id;
+}
+
+std::optional<Dictionary::ID> Dictionary::Find(std::string_view str) const
+{
+  if (const auto iter = ids_.find(str); iter != ids_.end()) return iter->second;
+  return std::nullopt;
+}
+}  // namespace inv::detail
@@ -0,0 +1,68 @@
+/**
+ * @file dictionary.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace inv::detail
+{
+/**
+ * Interns strings, assigning each distinct string a compact, dense ID.
+ *
+ * IDs are assigned in insertion order starting from zero and are never reused. References returned by Get stay valid
+ * for the lifetime of the Dictionary.
+ */
+class Dictionary
+{
+ public:
+  using ID = uint32_t;
+
+  Dictionary() = default;
+
+  /**
+   * Creates a Dictionary with the given strings interned in order, so that their IDs are known up front.
+   * @param reserved strings to intern
+   */
+  Dictionary(std::initializer_list<std::string_view> reserved);
+
+  /**
+   * Returns the ID of the given string, interning it if it is new.
+   * @param str the string to intern
+   * @return ID of str
+   */
+  ID Intern(std::string_view str);
+
+  /**
+   * Returns the ID of the given string if it has been interned.
+   * @param str the string to find
+   * @return ID of str, or nullopt if not interned
+   */
+  [[nodiscard]] std::optional<ID> Find(std::string_view str) const;
+
+  /**
+   * Returns the string with the given ID.
+   * @param id the ID of an interned string
+   * @return reference to the interned string
+   */
+  [[nodiscard]] const std::string& Get(ID id) const { return strings_[id]; }
+
+  /**
+   * Returns the number of interned strings. IDs are in [0, Size()).
+   */
+  [[nodiscard]] std::size_t Size() const noexcept { return strings_.size(); }
+
+ private:
+  std::deque<std::string> strings_;
+  std::unordered_map<std::string_view, ID> ids_;
+};
+}  // namespace inv::detail
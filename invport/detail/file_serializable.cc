@@ -6,11 +6,24 @@
 
 #include "invport/detail/file_serializable.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include <cerrno>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <system_error>
 
 #include "invport/detail/env.h"
+#include "invport/detail/uring_backend.h"
 
 namespace inv::file
 {
@@ -152,18 +165,212 @@ ValueWithErrorCode<std::string> ReadStream(const std::filesystem::path &path, st
 }
 
 /**
- * Writes contents to the given path.
- * @param path the path to write to
- * @param contents the data to write to path
+ * Returns the path that a file is written to before it is renamed over the given path.
+ */
+Path TempPath(const Path &path) { return path.string() + ".tmp"; }
+
+/**
+ * Closes the given stream, reporting whether its buffered writes made it to the file.
+ * @param path the path associated with stream
+ * @param stream the fstream to close
+ * @return ErrorCode denoting success or failure
+ */
+ErrorCode CloseFileStream(const Path &path, std::fstream &stream)
+{
+  stream.close();
+  if (!stream) return ErrorCode("fstream::close failed", {"path", ErrorCode(path.string())});
+
+  return {};
+}
+
+/**
+ * Flushes the contents of the given path to the storage device, which streams cannot do.
+ * @param path the path to flush
+ * @return ErrorCode denoting success or failure
+ */
+ErrorCode Fsync(const Path &path)
+{
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return ErrorCode("open failed", {{"path", ErrorCode(path.string())}, {"error", ErrorCode(strerror(errno))}});
+  }
+
+  const int result = fsync(fd);
+  const int error = errno;
+  close(fd);
+  if (result != 0)
+  {
+    return ErrorCode("fsync failed", {{"path", ErrorCode(path.string())}, {"error", ErrorCode(strerror(error))}});
+  }
+
+  return {};
+}
+
+/**
+ * Performs a request with blocking streams.
+ * @param request the request to perform
  * @return ErrorCode denoting success or failure
  */
-ErrorCode WriteFile(const Path &path, const std::string &contents)
+ErrorCode PerformRequest(const IoRequest &request)
 {
-  std::fstream out;
-  OpenFileStream(path, out, std::ios_base::out);
-  return WriteStream(path, contents, out);
+  std::fstream stream;
+  switch (request.type)
+  {
+    case IoRequest::CREATE:
+    {
+      auto ec = OpenFileStream(request.path, stream, std::ios_base::out | std::ios_base::trunc);
+      if (ec.Failure()) return ec;
+
+      return CloseFileStream(request.path, stream);
+    }
+
+    case IoRequest::WRITE:
+    {
+      // Opening for input as well keeps the rest of the file, but only works if the file exists.
+      auto mode = std::ios_base::out;
+      if (fs::exists(request.path)) mode |= std::ios_base::in;
+      auto ec = OpenFileStream(request.path, stream, mode);
+      if (ec.Failure()) return ec;
+
+      stream.seekp(static_cast<std::streamoff>(request.offset));
+      ec = WriteStream(request.path, request.data, stream);
+      if (ec.Failure()) return ec;
+
+      return CloseFileStream(request.path, stream);
+    }
+
+    case IoRequest::APPEND:
+    {
+      auto ec = OpenFileStream(request.path, stream, std::ios_base::out | std::ios_base::app);
+      if (ec.Failure()) return ec;
+
+      ec = WriteStream(request.path, request.data, stream);
+      if (ec.Failure()) return ec;
+
+      return CloseFileStream(request.path, stream);
+    }
+
+    case IoRequest::FSYNC:
+    {
+      return Fsync(request.path);
+    }
+
+    case IoRequest::RENAME:
+    {
+      std::error_code error;
+      fs::rename(request.path, request.target, error);
+      if (error)
+      {
+        return ErrorCode("fs::rename failed",
+                         {{"path", ErrorCode(request.path.string())},
+                          {"target", ErrorCode(request.target.string())},
+                          {"error", ErrorCode(error.message())}});
+      }
+
+      return {};
+    }
+
+    default:
+      return ErrorCode("Invalid IoRequest type");
+  }
 }
 
+/**
+ * A stream buffer that writes a file through an IoBackend in chunks. A full chunk is submitted without waiting for it,
+ * so the writer fills the next chunk while the previous ones are written.
+ */
+class ChunkedWriteBuffer : public std::streambuf
+{
+ public:
+  static constexpr const std::size_t kChunkBytes = std::size_t{1} << 20;
+  static constexpr const std::size_t kMaxChunksInFlight = 4;
+
+  ChunkedWriteBuffer(std::shared_ptr<IoBackend> backend, Path path)
+      : backend_(std::move(backend)), path_(std::move(path))
+  {
+    Reset();
+  }
+
+  ChunkedWriteBuffer(const ChunkedWriteBuffer &) = delete;
+  ChunkedWriteBuffer &operator=(const ChunkedWriteBuffer &) = delete;
+
+  ~ChunkedWriteBuffer() override
+  {
+    // The callbacks of the chunks in flight refer to this buffer.
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return in_flight_ == 0; });
+  }
+
+  /**
+   * Submits what is left, and waits for every chunk to be written.
+   * @return ErrorCode of the first chunk that failed, if any
+   */
+  ErrorCode Finish()
+  {
+    SubmitChunk();
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return in_flight_ == 0; });
+    return ec_;
+  }
+
+ protected:
+  int_type overflow(const int_type ch) override
+  {
+    if (!SubmitChunk()) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+ private:
+  void Reset()
+  {
+    chunk_.resize(kChunkBytes);
+    setp(chunk_.data(), chunk_.data() + chunk_.size());
+  }
+
+  /**
+   * Submits the buffered chunk, first waiting until fewer than kMaxChunksInFlight are in flight.
+   * @return whether every chunk so far succeeded
+   */
+  bool SubmitChunk()
+  {
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    if (size == 0) return true;
+
+    {
+      std::unique_lock lock(mutex_);
+      done_.wait(lock, [this] { return in_flight_ < kMaxChunksInFlight; });
+      if (ec_.Failure()) return false;
+      ++in_flight_;
+    }
+
+    chunk_.resize(size);
+    const auto offset = std::exchange(offset_, offset_ + size);
+    backend_->Submit({IoRequest::Write(path_, std::exchange(chunk_, {}), offset)}, [this](ErrorCode ec) {
+      std::lock_guard lock(mutex_);
+      if (ec.Failure() && ec_.Success()) ec_ = std::move(ec);
+      --in_flight_;
+      done_.notify_all();
+    });
+    Reset();
+    return true;
+  }
+
+  const std::shared_ptr<IoBackend> backend_;
+  const Path path_;
+  std::string chunk_;
+  uint64_t offset_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::size_t in_flight_ = 0;
+  ErrorCode ec_;
+};
+
 /**
  * Reads all data from the given path.
  * @param path the path to read from
@@ -178,8 +385,151 @@ ValueWithErrorCode<std::string> ReadFile(const Path &path)
 
 // endregion Reading and Writing
 
+std::mutex backend_mutex;
+std::shared_ptr<IoBackend> backend;  // Created by the first write, unless one was set.
+
 }  // namespace
 
+ErrorCode IoBackend::Perform(std::vector<IoRequest> batch)
+{
+  std::promise<ErrorCode> done;
+  auto result = done.get_future();
+  Submit(std::move(batch), [&done](ErrorCode ec) { done.set_value(std::move(ec)); });
+  return result.get();
+}
+
+ThreadedBackend::ThreadedBackend() : thread_(&ThreadedBackend::Run, this) {}
+
+ThreadedBackend::~ThreadedBackend()
+{
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+void ThreadedBackend::Submit(std::vector<IoRequest> batch, Callback on_complete)
+{
+  {
+    std::lock_guard lock(mutex_);
+    queue_.emplace_back(std::move(batch), std::move(on_complete));
+  }
+  wake_.notify_one();
+}
+
+void ThreadedBackend::Run()
+{
+  std::unique_lock lock(mutex_);
+  while (true)
+  {
+    wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;
+
+    auto [batch, on_complete] = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+
+    ErrorCode ec;
+    for (const auto &request : batch)
+    {
+      ec = PerformRequest(request);
+      if (ec.Failure()) break;
+    }
+    on_complete(std::move(ec));
+
+    lock.lock();
+  }
+}
+
+std::shared_ptr<IoBackend> GetIoBackend()
+{
+  std::lock_guard lock(backend_mutex);
+  if (backend == nullptr)
+  {
+    auto [uring, ec] = UringBackend::Factory();
+    if (ec.Success())
+    {
+      backend = std::move(uring);
+    }
+    else
+    {
+      spdlog::info(ErrorCode("io_uring is not available, writing files on a thread instead", std::move(ec)));
+      backend = std::make_shared<ThreadedBackend>();
+    }
+  }
+  return backend;
+}
+
+void SetIoBackend(std::shared_ptr<IoBackend> io_backend)
+{
+  std::lock_guard lock(backend_mutex);
+  backend = std::move(io_backend);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+  if (this != &other)
+  {
+    if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+}
+
+ValueWithErrorCode<MappedFile> MappedFile::Factory(const Path &path)
+{
+  if (!fs::exists(path))
+  {
+    return {};
+  }
+
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return {MappedFile(),
+            ErrorCode("open failed", {{"path", ErrorCode(path.string())}, {"error", ErrorCode(strerror(errno))}})};
+  }
+
+  struct stat st
+  {
+  };
+  if (fstat(fd, &st) != 0)
+  {
+    const int error = errno;
+    close(fd);
+    return {MappedFile(),
+            ErrorCode("fstat failed", {{"path", ErrorCode(path.string())}, {"error", ErrorCode(strerror(error))}})};
+  }
+
+  MappedFile file;
+  if (st.st_size > 0)
+  {
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      const int error = errno;
+      close(fd);
+      return {MappedFile(),
+              ErrorCode("mmap failed", {{"path", ErrorCode(path.string())}, {"error", ErrorCode(strerror(error))}})};
+    }
+
+    file.data_ = static_cast<const char *>(data);
+    file.size_ = st.st_size;
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  return {std::move(file), ErrorCode()};
+}
+
 FileIoBase::FileIoBase(const Path &relative_path, const Directory directory, const Extension extension)
     : directory_path_(GetDirectoryPath(directory)),
       full_path_((directory_path_ / relative_path).string() + GetExtensionString(extension))
@@ -224,6 +574,14 @@ std::string FileIoBase::GetExtensionString(Extension extension)
     {
       return ".json";
     }
+    case Extension::JSONL:
+    {
+      return ".jsonl";
+    }
+    case Extension::BINARY:
+    {
+      return ".bin";
+    }
     default:
     {
       ec_ = ErrorCode("Invalid Extension");
@@ -232,11 +590,51 @@ std::string FileIoBase::GetExtensionString(Extension extension)
   }
 }
 
-ErrorCode FileIoBase::WriteFile(const std::string &contents) const
+ErrorCode FileIoBase::WriteFile(std::string contents) const
 {
-  return ::inv::file::WriteFile(full_path_, contents);
+  const auto temp = TempPath(full_path_);
+  return GetIoBackend()->Perform({IoRequest::Create(temp),
+                                  IoRequest::Write(temp, std::move(contents)),
+                                  IoRequest::Fsync(temp),
+                                  IoRequest::Rename(temp, full_path_)});
+}
+
+ErrorCode FileIoBase::WriteFile(const std::function<ErrorCode(std::ostream &)> &write) const
+{
+  const auto backend = GetIoBackend();
+  const auto temp = TempPath(full_path_);
+  auto ec = backend->Perform({IoRequest::Create(temp)});
+  if (ec.Failure()) return ec;
+
+  ChunkedWriteBuffer buffer(backend, temp);
+  std::ostream out(&buffer);
+  try
+  {
+    ec = write(out);
+  }
+  catch (const std::exception &e)
+  {
+    ec = ErrorCode(e.what());
+  }
+
+  // A chunk that failed to be written fails the stream, so its error comes first.
+  auto write_ec = buffer.Finish();
+  if (write_ec.Failure()) ec = std::move(write_ec);
+  if (ec.Failure())
+  {
+    return ErrorCode("WriteFile failed", {{"path", ErrorCode(full_path_.string())}, {"error", std::move(ec)}});
+  }
+
+  return backend->Perform({IoRequest::Fsync(temp), IoRequest::Rename(temp, full_path_)});
+}
+
+ErrorCode FileIoBase::AppendFile(std::string contents) const
+{
+  return GetIoBackend()->Perform({IoRequest::Append(full_path_, std::move(contents))});
 }
 
 ValueWithErrorCode<std::string> FileIoBase::ReadFile() const { return ::inv::file::ReadFile(full_path_); }
 
+ValueWithErrorCode<MappedFile> FileIoBase::MapFile() const { return MappedFile::Factory(full_path_); }
+
 }  // namespace inv::file
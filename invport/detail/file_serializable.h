@@ -6,9 +6,19 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "invport/detail/common.h"
 
@@ -49,9 +59,171 @@ enum Extension
   /**
    * JSON format: .json
    */
-  JSON
+  JSON,
+
+  /**
+   * JSON lines format, one JSON value per line: .jsonl
+   */
+  JSONL,
+
+  /**
+   * Binary format: .bin
+   */
+  BINARY
+};
+
+/**
+ * A read-only memory mapping of a file's contents. The mapping is released on destruction.
+ */
+class MappedFile
+{
+ public:
+  MappedFile() noexcept = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  /**
+   * Maps the file at the given path. A missing or empty file is mapped as an empty view.
+   * @param path the path of the file to map
+   * @return MappedFile if success, or ErrorCode denoting failure
+   */
+  static ValueWithErrorCode<MappedFile> Factory(const Path& path);
+
+  /**
+   * Returns the file's contents. The view is valid for the lifetime of this object.
+   */
+  [[nodiscard]] std::string_view View() const noexcept { return {data_, size_}; }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
 };
 
+/**
+ * A file operation to be performed by an IoBackend.
+ */
+struct IoRequest
+{
+  enum Type
+  {
+    /**
+     * Creates the file, or empties it if it exists.
+     */
+    CREATE,
+
+    /**
+     * Writes data at offset, creating the file if it does not exist.
+     */
+    WRITE,
+
+    /**
+     * Appends data to the file, creating it if it does not exist.
+     */
+    APPEND,
+
+    /**
+     * Flushes the file's contents to the storage device.
+     */
+    FSYNC,
+
+    /**
+     * Renames the file to target, replacing any file there.
+     */
+    RENAME
+  };
+
+  static IoRequest Create(Path path) { return {CREATE, std::move(path), {}, 0, {}}; }
+
+  static IoRequest Write(Path path, std::string data, uint64_t offset = 0)
+  {
+    return {WRITE, std::move(path), std::move(data), offset, {}};
+  }
+
+  static IoRequest Append(Path path, std::string data) { return {APPEND, std::move(path), std::move(data), 0, {}}; }
+
+  static IoRequest Fsync(Path path) { return {FSYNC, std::move(path), {}, 0, {}}; }
+
+  static IoRequest Rename(Path path, Path target) { return {RENAME, std::move(path), {}, 0, std::move(target)}; }
+
+  Type type;
+  Path path;
+  std::string data;
+  uint64_t offset;
+  Path target;
+};
+
+/**
+ * Performs batches of file operations off the calling thread.
+ */
+class IoBackend
+{
+ public:
+  using Callback = std::function<void(ErrorCode)>;
+
+  virtual ~IoBackend() = default;
+
+  /**
+   * Performs the requests of a batch in order. Once a request fails, the rest of the batch fails without being
+   * performed. Separate batches may be performed concurrently, in any order.
+   * @param batch the requests to perform
+   * @param on_complete called with the error of the failed request, if any, once the batch is done. It may be called on
+   * another thread, and must not wait for other batches.
+   */
+  virtual void Submit(std::vector<IoRequest> batch, Callback on_complete) = 0;
+
+  /**
+   * Submits a batch, and blocks until it is done.
+   * @return ErrorCode of the failed request, if any
+   */
+  ErrorCode Perform(std::vector<IoRequest> batch);
+};
+
+/**
+ * Performs batches one at a time on a worker thread, with the same blocking streams that FileIoBase has always used.
+ * This is the fallback wherever io_uring is not available.
+ */
+class ThreadedBackend : public IoBackend
+{
+ public:
+  ThreadedBackend();
+
+  ThreadedBackend(const ThreadedBackend&) = delete;
+  ThreadedBackend& operator=(const ThreadedBackend&) = delete;
+
+  /**
+   * Finishes the queued batches, then joins the thread.
+   */
+  ~ThreadedBackend() override;
+
+  void Submit(std::vector<IoRequest> batch, Callback on_complete) override;
+
+ private:
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::pair<std::vector<IoRequest>, Callback>> queue_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+/**
+ * Returns the backend that every FileIoBase writes through. Unless one was set, it is a UringBackend if the kernel
+ * supports it, and a ThreadedBackend otherwise.
+ */
+std::shared_ptr<IoBackend> GetIoBackend();
+
+/**
+ * Replaces the backend that every FileIoBase writes through, such as to observe writes in tests. Writes in progress
+ * finish on the old backend.
+ * @param backend the new backend, or null to go back to the default
+ */
+void SetIoBackend(std::shared_ptr<IoBackend> backend);
+
 /**
  * This is used as a base class for classes that can be read from or written to an associated file.
  * Note: these member functions are not thread-safe by design.
@@ -68,18 +240,42 @@ class FileIoBase
 
  protected:
   /**
-   * Writes contents to the associated file.
+   * Replaces the associated file's contents. They are written to a temporary file that is synced and then renamed over
+   * the associated file, so the file is never left half-written. Like every write, this goes through GetIoBackend(),
+   * and blocks until it is done.
    * @param contents data to write
    * @return ErrorCode indicating success or failure
    */
-  [[nodiscard]] ErrorCode WriteFile(const std::string& contents) const;
+  [[nodiscard]] ErrorCode WriteFile(std::string contents) const;
 
   /**
-   * Reads contents of associated file.
+   * Replaces the associated file's contents through a stream, so that they never need to be held in memory at once.
+   * The stream hands the backend 1 MiB chunks without waiting for them, so the contents are written while the rest are
+   * produced, with at most four chunks in flight. Like WriteFile(std::string), the file is replaced atomically.
+   * @param write callback that writes the contents to the given stream
+   * @return ErrorCode indicating success or failure of opening the file or of write
+   */
+  [[nodiscard]] ErrorCode WriteFile(const std::function<ErrorCode(std::ostream&)>& write) const;
+
+  /**
+   * Appends contents to the end of the associated file, creating it if it does not exist.
+   * @param contents data to append
+   * @return ErrorCode indicating success or failure
+   */
+  [[nodiscard]] ErrorCode AppendFile(std::string contents) const;
+
+  /**
+   * Reads contents of associated file into a string. Parsers should prefer MapFile(), which does not copy.
    * @return Contents of file if success, or ErrorCode denoting failure.
    */
   [[nodiscard]] ValueWithErrorCode<std::string> ReadFile() const;
 
+  /**
+   * Maps the associated file into memory, so that it can be read without copying.
+   * @return MappedFile if success, or ErrorCode denoting failure.
+   */
+  [[nodiscard]] ValueWithErrorCode<MappedFile> MapFile() const;
+
   /**
    * Returns whether this class instance is valid to be used.
    * @return ErrorCode denoting whether valid or not
@@ -0,0 +1,58 @@
+/**
+ * @file fingerprint_index.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/fingerprint_index.h"
+
+#include <algorithm>
+
+namespace inv::detail
+{
+void FingerprintIndex::Insert(const Transaction& tr) { buckets_[tr.Fingerprint()].push_back(tr.id); }
+
+void FingerprintIndex::Erase(const Transaction& tr)
+{
+  const auto it = buckets_.find(tr.Fingerprint());
+  if (it == buckets_.end()) return;
+
+  auto& bucket = it->second;
+  if (const auto id = std::find(bucket.begin(), bucket.end(), tr.id); id != bucket.end())
+  {
+    *id = bucket.back();
+    bucket.pop_back();
+  }
+  if (bucket.empty()) buckets_.erase(it);
+}
+
+std::vector<FingerprintIndex::ID> FingerprintIndex::Missing(const std::vector<ID>& ids) const
+{
+  // Each transaction in the index can be the duplicate of one of ids only, so the matched ones are taken out of a copy
+  // of their bucket. Only the buckets of the given fingerprints are copied.
+  std::unordered_map<uint64_t, std::vector<ID>> unmatched;
+  std::vector<ID> missing;
+  for (const auto id : ids)
+  {
+    const auto& tr = *TransactionPool::Find(id);
+    const auto fingerprint = tr.Fingerprint();
+
+    auto [it, inserted] = unmatched.try_emplace(fingerprint);
+    if (inserted)
+      if (const auto bucket = buckets_.find(fingerprint); bucket != buckets_.end()) it->second = bucket->second;
+
+    auto& candidates = it->second;
+    const auto match = std::find_if(candidates.begin(), candidates.end(), [&tr](ID candidate) {
+      return candidate == tr.id || TransactionPool::Find(candidate)->MemberwiseEquals(tr);
+    });
+    if (match == candidates.end())
+    {
+      missing.push_back(id);
+      continue;
+    }
+    *match = candidates.back();
+    candidates.pop_back();
+  }
+  return missing;
+}
+}  // namespace inv::detail
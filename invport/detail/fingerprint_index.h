@@ -0,0 +1,45 @@
+/**
+ * @file fingerprint_index.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "invport/detail/transaction.h"
+
+namespace inv::detail
+{
+/**
+ * Index of transactions by Transaction::Fingerprint, for finding the memberwise duplicates of a transaction in
+ * constant time.
+ *
+ * Transactions with equal fingerprints share a bucket, which is checked with Transaction::MemberwiseEquals, so a hash
+ * collision never makes two different transactions duplicates.
+ */
+class FingerprintIndex
+{
+ public:
+  using ID = Transaction::ID;
+
+  void Insert(const Transaction& tr);
+
+  void Erase(const Transaction& tr);
+
+  /**
+   * Returns the given transactions that are missing from the index, as a multiset: if the index has n transactions
+   * memberwise equal to a transaction, the first n of its duplicates in ids are not missing. Runs in time linear in
+   * the number of ids.
+   * @param ids the transactions to check, which must be in the TransactionPool
+   * @return the missing ids, in the order given
+   */
+  [[nodiscard]] std::vector<ID> Missing(const std::vector<ID>& ids) const;
+
+ private:
+  std::unordered_map<uint64_t, std::vector<ID>> buckets_;
+};
+}  // namespace inv::detail
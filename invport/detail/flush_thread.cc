@@ -0,0 +1,85 @@
+/**
+ * @file flush_thread.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/flush_thread.h"
+
+#include <spdlog/spdlog.h>
+
+#include <exception>
+#include <utility>
+
+namespace inv::detail
+{
+FlushThread::FlushThread(const std::chrono::milliseconds window) : window_(window) {}
+
+FlushThread::~FlushThread()
+{
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) thread_.join();
+}
+
+void FlushThread::Submit(Write write)
+{
+  {
+    std::lock_guard lock(mutex_);
+    queue_.push_back(std::move(write));
+    ++submitted_;
+    if (!thread_.joinable()) thread_ = std::thread(&FlushThread::Run, this);
+  }
+  wake_.notify_one();
+}
+
+bool FlushThread::Started() const
+{
+  std::lock_guard lock(mutex_);
+  return thread_.joinable();
+}
+
+void FlushThread::Wait()
+{
+  std::unique_lock lock(mutex_);
+  const auto target = submitted_;
+  ++waiters_;
+  wake_.notify_one();
+  finished_cv_.wait(lock, [this, target] { return finished_ >= target; });
+  --waiters_;
+}
+
+void FlushThread::Run()
+{
+  std::unique_lock lock(mutex_);
+  while (true)
+  {
+    wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;
+
+    // Let the rest of the burst arrive, unless someone is waiting for it to be written.
+    wake_.wait_for(lock, window_, [this] { return stop_ || waiters_ != 0; });
+
+    auto writes = std::exchange(queue_, {});
+    lock.unlock();
+    for (auto& write : writes)
+    {
+      try
+      {
+        write();
+      }
+      catch (const std::exception& e)
+      {
+        spdlog::critical("FlushThread write failed: {}", e.what());
+      }
+    }
+    lock.lock();
+
+    finished_ += writes.size();
+    finished_cv_.notify_all();
+  }
+}
+}  // namespace inv::detail
@@ -0,0 +1,81 @@
+/**
+ * @file flush_thread.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace inv::detail
+{
+/**
+ * A dedicated thread that performs file writes in the order they are submitted, so that callers never block on disk.
+ *
+ * After the first write of a burst is submitted, the thread waits for the coalescing window before writing, so that a
+ * burst of edits wakes it only once. Every write that is submitted runs; owners that can merge their writes do so
+ * before submitting them.
+ *
+ * The thread is started by the first write, so that owners which never write, such as temporary histories, cost no
+ * thread.
+ */
+class FlushThread
+{
+ public:
+  using Write = std::function<void()>;
+
+  static constexpr const std::chrono::milliseconds kDefaultWindow{250};
+
+  /**
+   * @param window how long to wait for more writes after the first of a burst is submitted
+   */
+  explicit FlushThread(std::chrono::milliseconds window = kDefaultWindow);
+
+  FlushThread(const FlushThread&) = delete;
+  FlushThread& operator=(const FlushThread&) = delete;
+
+  /**
+   * Finishes the queued writes without waiting for the window, then joins the thread, if it was started.
+   */
+  ~FlushThread();
+
+  /**
+   * Queues a write. Writes should report their own errors, as there is no caller to return them to.
+   * @param write the write to perform on the thread
+   */
+  void Submit(Write write);
+
+  /**
+   * Returns whether a write has been submitted, which starts the thread.
+   */
+  [[nodiscard]] bool Started() const;
+
+  /**
+   * Blocks until every write submitted so far has finished, without waiting for the window.
+   */
+  void Wait();
+
+ private:
+  void Run();
+
+  const std::chrono::milliseconds window_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable finished_cv_;
+  std::deque<Write> queue_;
+  uint64_t submitted_ = 0;
+  uint64_t finished_ = 0;
+  std::size_t waiters_ = 0;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+}  // namespace inv::detail
@@ -0,0 +1,135 @@
+/**
+ * @file import_ledger.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/import_ledger.h"
+
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "invport/detail/utils.h"
+
+namespace inv::import
+{
+Ledger::Ledger(const file::Path& relative_path, file::Directory directory)
+    : file_(std::make_shared<const File>(relative_path, directory))
+{
+  auto response = file_->MapFile();
+  if (response.second.Failure())
+  {
+    ec_ = {"Ledger::Ledger() failed", std::move(response.second)};
+  }
+  else if (!response.first.View().empty())
+  {
+    detail::JsonReader reader(response.first.View());
+    ec_ = Deserialize(reader);
+    if (ec_.Failure()) sources_.clear();
+  }
+}
+
+Source& Ledger::Find(const Schema& schema, const file::Path& path, uint64_t history)
+{
+  auto& entry = sources_[schema.name + ':' + file::fs::absolute(path).lexically_normal().string()];
+  if (entry.history != history) entry = {history, {}};
+  return entry.source;
+}
+
+std::function<ErrorCode()> Ledger::PrepareFlush() const
+{
+  std::string contents;
+  detail::JsonWriter writer(contents);
+  auto ec = Serialize(writer);
+  if (ec.Success()) ec = writer.Flush();
+
+  return [file = file_, contents = std::move(contents), ec = std::move(ec)]() -> ErrorCode {
+    auto write_ec = ec.Success() ? file->WriteFile(contents) : ec;
+    if (write_ec.Failure())
+    {
+      return {"Ledger::Flush() failed", std::move(write_ec)};
+    }
+
+    return {};
+  };
+}
+
+ErrorCode Ledger::Serialize(detail::JsonWriter& writer) const
+{
+  writer.BeginObject();
+  for (const auto& [key, entry] : sources_)
+  {
+    const auto& source = entry.source;
+    writer.Key(key).BeginObject();
+    writer.Key("history").Number(entry.history);
+    writer.Key("hash").Number(source.imported_hash);
+    writer.Key("size").Number(source.imported_size);
+    writer.Key("rows").BeginObject();
+    for (const auto& [fingerprint, count] : source.rows) writer.Key(ToString(fingerprint)).Number(count);
+    writer.EndObject();
+    writer.EndObject();
+  }
+  writer.EndObject();
+  return {};
+}
+
+ErrorCode Ledger::Deserialize(detail::JsonReader& reader)
+{
+  try
+  {
+    reader.BeginObject();
+    while (reader.HasNext())
+    {
+      auto& entry = sources_[std::string(reader.Key())];
+      auto& source = entry.source;
+      reader.BeginObject();
+      while (reader.HasNext())
+      {
+        const auto name = reader.Key();
+        if (name == "history")
+        {
+          entry.history = reader.Number<uint64_t>();
+        }
+        else if (name == "hash")
+        {
+          source.imported_hash = reader.Number<uint64_t>();
+        }
+        else if (name == "size")
+        {
+          source.imported_size = reader.Number<std::size_t>();
+        }
+        else if (name == "rows")
+        {
+          // Rows map each fingerprint, as a decimal key, to its count.
+          reader.BeginObject();
+          while (reader.HasNext())
+          {
+            const auto key = reader.Key();
+            uint64_t fingerprint = 0;
+            const auto result = FromChars(key, fingerprint);
+            if (result.ec != std::errc() || result.ptr != key.data() + key.size())
+              throw std::runtime_error("invalid fingerprint " + std::string(key));
+            source.rows[fingerprint] = reader.Number<uint32_t>();
+          }
+          reader.EndObject();
+        }
+        else
+        {
+          reader.Skip();
+        }
+      }
+      reader.EndObject();
+    }
+    reader.EndObject();
+    reader.Finish();
+    return {};
+  }
+  catch (const std::exception& e)
+  {
+    return {"Ledger::Deserialize() failed", ErrorCode{e.what()}};
+  }
+}
+}  // namespace inv::import
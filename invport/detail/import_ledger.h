@@ -0,0 +1,99 @@
+/**
+ * @file import_ledger.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "invport/detail/file_serializable.h"
+#include "invport/detail/importer.h"
+#include "invport/detail/json_reader.h"
+#include "invport/detail/json_writer.h"
+
+namespace inv::import
+{
+/**
+ * Records what has been imported from each export, so that importing an export again only adds its new rows.
+ */
+class Ledger
+{
+ public:
+  /**
+   * Reads the ledger from a file in the specified directory.
+   * @param relative_path the path of the ledger file, relative to directory
+   * @param directory the location of the ledger file
+   */
+  explicit Ledger(const file::Path& relative_path = "import_ledger", file::Directory directory = file::Directory::HOME);
+
+  /**
+   * Returns what has been imported from the export at the given path with the given schema into the given history,
+   * which is empty if nothing has been. Exports are identified by their absolute path. A record of imports into
+   * another history, such as one that has since been replaced, is reset.
+   * @param schema the schema of the export
+   * @param path the path of the export
+   * @param history the TransactionHistory::Identity() of the history that the export is imported into
+   * @return the record of the export, which the importer updates
+   */
+  Source& Find(const Schema& schema, const file::Path& path, uint64_t history);
+
+  /**
+   * Writes the ledger to its file.
+   * @return ErrorCode indicating success or failure
+   */
+  [[nodiscard]] ErrorCode Flush() const { return PrepareFlush()(); }
+
+  /**
+   * Serializes the ledger on the calling thread, and returns a write of it to its file that may be performed later on
+   * another thread, such as by TransactionHistory::AfterFlush(). The write holds its own copy of the ledger, and stays
+   * valid after the ledger is destroyed.
+   * @return the write, which returns an ErrorCode indicating success or failure
+   */
+  [[nodiscard]] std::function<ErrorCode()> PrepareFlush() const;
+
+  /**
+   * Indicates whether reading the ledger was successful or not. If not, it starts out empty.
+   * @return ErrorCode indicating success or failure
+   */
+  [[nodiscard]] const ErrorCode& LedgerValidity() const noexcept { return ec_; }
+
+ private:
+  ErrorCode Serialize(detail::JsonWriter& writer) const;
+
+  ErrorCode Deserialize(detail::JsonReader& reader);
+
+  /**
+   * What has been imported from an export, and the history it was imported into.
+   */
+  struct Entry
+  {
+    uint64_t history = 0;
+    Source source;
+  };
+
+  /**
+   * The ledger's file. It is shared with the writes returned by PrepareFlush().
+   */
+  class File : public file::FileIoBase
+  {
+   public:
+    using file::FileIoBase::FileIoBase;
+    using file::FileIoBase::MapFile;
+    using file::FileIoBase::WriteFile;
+  };
+
+  std::shared_ptr<const File> file_;
+  std::unordered_map<std::string, Entry> sources_;
+
+  /**
+   * Stores construction error if any
+   */
+  ErrorCode ec_;
+};
+}  // namespace inv::import
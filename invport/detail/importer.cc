@@ -0,0 +1,478 @@
+/**
+ * @file importer.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/importer.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include "invport/detail/csv.h"
+#include "invport/detail/parallel.h"
+#include "invport/detail/utils.h"
+
+namespace inv::import
+{
+namespace
+{
+using Transaction = TransactionHistory::Transaction;
+
+enum Field
+{
+  DATE,
+  SYMBOL,
+  TYPE,
+  QUANTITY,
+  PRICE,
+  FEE,
+  ACCOUNT,
+  SETTLEMENT_DATE,
+  NUM_FIELDS
+};
+
+constexpr std::size_t kUnmapped = std::numeric_limits<std::size_t>::max();
+
+std::array<const Column*, NUM_FIELDS> GetColumns(const Schema& schema)
+{
+  return {&schema.date,  &schema.symbol, &schema.type,    &schema.quantity,
+          &schema.price, &schema.fee,    &schema.account, &schema.settlement_date};
+}
+
+/**
+ * The field indices of the columns of a particular export. Unlike names, they are known once its header is found.
+ */
+struct Plan
+{
+  std::array<std::size_t, NUM_FIELDS> index;
+  std::size_t split_fields;  // The number of fields to split each row into.
+};
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsDigits(std::string_view str, std::size_t min_size, std::size_t max_size)
+{
+  return str.size() >= min_size && str.size() <= max_size && std::all_of(str.begin(), str.end(), IsDigit);
+}
+
+/**
+ * Returns whether str is a date of one or two digit days and months and four digit years, separated by slashes.
+ */
+bool IsDate(std::string_view str)
+{
+  const auto first = str.find('/');
+  const auto second = str.find('/', first + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos) return false;
+  return IsDigits(str.substr(0, first), 1, 2) && IsDigits(str.substr(first + 1, second - first - 1), 1, 2) &&
+         IsDigits(str.substr(second + 1), 4, 4);
+}
+
+/**
+ * The most digits of an account number, so that it always fits in a uint64_t.
+ */
+constexpr std::size_t kMaxAccountDigits = 19;
+
+/**
+ * Returns the given digits without leading zeros, as the number they parse to would be formatted.
+ */
+std::string_view TrimLeadingZeros(std::string_view digits)
+{
+  return digits.substr(std::min(digits.find_first_not_of('0'), digits.size() - 1));
+}
+
+bool IsSymbol(std::string_view str)
+{
+  return std::all_of(str.begin(), str.end(), [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || std::string_view("_*+#^=.").find(c) != std::string_view::npos;
+  });
+}
+
+/**
+ * Returns whether str is digits and periods, optionally preceded by a minus sign. It may be empty.
+ */
+bool IsNumber(std::string_view str)
+{
+  if (!str.empty() && str.front() == '-') str.remove_prefix(1);
+  return std::all_of(str.begin(), str.end(), [](char c) { return IsDigit(c) || c == '.'; });
+}
+
+/**
+ * Returns the next line of data at or after begin, without its newline or carriage return, and sets line_end to the
+ * offset of its newline.
+ */
+std::string_view NextLine(std::string_view data, std::size_t begin, std::size_t& line_end)
+{
+  line_end = std::min(data.find('\n', begin), data.size());
+  auto line = data.substr(begin, line_end - begin);
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  return line;
+}
+
+/**
+ * A transaction row that has been parsed, but not added to a history yet.
+ */
+struct Row
+{
+  std::size_t offset;  // The offset of the row in the section.
+  Transaction::Type type;
+  Date date;
+  std::string_view symbol;
+  Transaction::Quantity quantity;
+  Price price;
+  Price fee;
+  std::string_view account;
+  uint64_t fingerprint;      // The hash of the row's text.
+  std::exception_ptr error;  // Set if the row has the shape of a transaction, but invalid values.
+};
+
+/**
+ * The rows of a chunk of the section, in file order.
+ */
+struct Chunk
+{
+  std::vector<Row> rows;
+  std::optional<std::size_t> first_row;    // The offset of the first row with the shape of a transaction.
+  std::optional<std::size_t> first_other;  // The offset of the first non-empty row without it.
+  std::optional<std::size_t> end;          // The offset of the first row without it after first_row.
+};
+
+class ChunkParser
+{
+ public:
+  /**
+   * @param stage_rows whether to parse the transactions into rows, or only to find where they are
+   */
+  ChunkParser(const Schema& schema, const Plan& plan, std::string_view data, bool stage_rows)
+      : schema_(schema), plan_(plan), data_(data), stage_rows_(stage_rows)
+  {
+  }
+
+  /**
+   * Parses the rows that start in [begin, end) of the data.
+   */
+  Chunk operator()(std::size_t begin, std::size_t end) const
+  {
+    // A row that starts in the previous chunk belongs to it.
+    if (begin != 0 && data_[begin - 1] != '\n')
+    {
+      begin = data_.find('\n', begin);
+      begin = begin == std::string_view::npos ? data_.size() : begin + 1;
+    }
+
+    Chunk chunk;
+    std::vector<std::string_view> fields(plan_.split_fields);
+    for (std::size_t line_end; begin < end && begin < data_.size(); begin = line_end + 1)
+    {
+      const auto line = NextLine(data_, begin, line_end);
+      if (line.empty()) continue;
+
+      const auto num_fields = detail::SplitFields(line, fields.data(), fields.size(), schema_.delimiter);
+      if (!IsTransactionRow(fields, num_fields))
+      {
+        if (!chunk.first_other.has_value()) chunk.first_other = begin;
+        if (chunk.first_row.has_value())
+        {
+          chunk.end = begin;
+          break;
+        }
+        continue;
+      }
+      if (!chunk.first_row.has_value()) chunk.first_row = begin;
+      if (!stage_rows_) continue;
+
+      const auto type_field = Get(fields, TYPE);
+      const auto type = std::find_if(schema_.types.begin(), schema_.types.end(),
+                                     [type_field](const auto& entry) { return entry.first == type_field; });
+      if (type == schema_.types.end()) continue;
+
+      Row row{};
+      row.offset = begin;
+      row.type = type->second;
+      row.symbol = Get(fields, SYMBOL);
+      row.quantity = ToNum<Transaction::Quantity>(Get(fields, QUANTITY));
+      row.price = ToNum<Price>(Get(fields, PRICE));
+      row.fee = ToNum<Price>(Get(fields, FEE));
+      row.account = schema_.numeric_accounts ? TrimLeadingZeros(Get(fields, ACCOUNT)) : Get(fields, ACCOUNT);
+      row.fingerprint = Fnv1a(line);
+      try
+      {
+        row.date = Date(Get(fields, DATE), schema_.date_format);
+        if (plan_.index[SETTLEMENT_DATE] != kUnmapped)
+          static_cast<void>(Date(Get(fields, SETTLEMENT_DATE), schema_.date_format));
+      }
+      catch (const std::exception&)
+      {
+        row.error = std::current_exception();
+      }
+
+      if (schema_.negative_sells && row.type == Transaction::Type::SELL) row.quantity = -row.quantity;
+      chunk.rows.push_back(row);
+    }
+    return chunk;
+  }
+
+ private:
+  /**
+   * Returns the given field of a row, or an empty view if the schema does not map it.
+   */
+  [[nodiscard]] std::string_view Get(const std::vector<std::string_view>& fields, Field field) const
+  {
+    return plan_.index[field] == kUnmapped ? std::string_view() : fields[plan_.index[field]];
+  }
+
+  [[nodiscard]] bool IsTransactionRow(const std::vector<std::string_view>& fields, std::size_t num_fields) const
+  {
+    if (schema_.num_fields != 0 ? num_fields != schema_.num_fields : num_fields < plan_.split_fields) return false;
+    if (!IsDate(Get(fields, DATE)) || !IsSymbol(Get(fields, SYMBOL))) return false;
+    if (plan_.index[SETTLEMENT_DATE] != kUnmapped && !IsDate(Get(fields, SETTLEMENT_DATE))) return false;
+    if (schema_.numeric_accounts && !IsDigits(Get(fields, ACCOUNT), 1, kMaxAccountDigits)) return false;
+    return IsNumber(Get(fields, QUANTITY)) && IsNumber(Get(fields, PRICE)) && IsNumber(Get(fields, FEE));
+  }
+
+  const Schema& schema_;
+  const Plan& plan_;
+  std::string_view data_;
+  bool stage_rows_;
+};
+}  // namespace
+
+Importer::Importer(Schema schema) : schema_(std::move(schema))
+{
+  const auto columns = GetColumns(schema_);
+  for (const auto field : {DATE, SYMBOL, TYPE, QUANTITY, PRICE})
+    if (!columns[field]->IsMapped())
+      throw std::invalid_argument("Schema " + schema_.name + " is missing a required column");
+
+  if (schema_.types.empty()) throw std::invalid_argument("Schema " + schema_.name + " has no types");
+  if (schema_.account.IsMapped() && schema_.account_tag.empty())
+    throw std::invalid_argument("Schema " + schema_.name + " has an account column without an account tag");
+  if (schema_.numeric_accounts && !schema_.account.IsMapped())
+    throw std::invalid_argument("Schema " + schema_.name + " has numeric accounts without an account column");
+
+  for (const auto* column : columns)
+  {
+    if (column->index.has_value() && schema_.num_fields != 0 && *column->index >= schema_.num_fields)
+      throw std::invalid_argument("Schema " + schema_.name + " has a column index past its number of fields");
+    has_header_ |= !column->name.empty();
+  }
+}
+
+TransactionHistory Importer::Parse(const file::Path& path, std::size_t min_chunk_bytes) const
+{
+  return Import(path, nullptr, min_chunk_bytes);
+}
+
+TransactionHistory Importer::ParseContents(std::string_view data, std::size_t min_chunk_bytes) const
+{
+  return ImportContents(data, nullptr, min_chunk_bytes);
+}
+
+TransactionHistory Importer::Parse(const file::Path& path, Source& source, std::size_t min_chunk_bytes) const
+{
+  return Import(path, &source, min_chunk_bytes);
+}
+
+TransactionHistory Importer::ParseContents(std::string_view data, Source& source, std::size_t min_chunk_bytes) const
+{
+  return ImportContents(data, &source, min_chunk_bytes);
+}
+
+TransactionHistory Importer::Import(const file::Path& path, Source* source, std::size_t min_chunk_bytes) const
+{
+  spdlog::info("Parsing {0} file with path {1}", schema_.name, path.string());
+
+  const auto [file, ec] = file::MappedFile::Factory(path);
+  if (ec.Failure())
+  {
+    spdlog::error(ErrorCode("Importer::Parse() failed", ErrorCode(ec)));
+    return TransactionHistory(TransactionHistory::kTempTag);
+  }
+
+  // The mapping is file-backed, so the export is never copied.
+  return ImportContents(file.View(), source, min_chunk_bytes);
+}
+
+TransactionHistory Importer::ImportContents(std::string_view data, Source* source, std::size_t min_chunk_bytes) const
+{
+  TransactionHistory th(TransactionHistory::kTempTag);
+  const auto columns = GetColumns(schema_);
+
+  // Column indices are resolved once per export, so parsing a row is a lookup per field.
+  Plan plan{};
+  std::size_t section_begin = 0;
+  bool resolved = !has_header_;
+  std::vector<std::string_view> header;
+  for (std::size_t line_end; !resolved && section_begin < data.size(); section_begin = line_end + 1)
+  {
+    const auto line = NextLine(data, section_begin, line_end);
+    header.resize(detail::SplitFields(line, header.data(), header.size(), schema_.delimiter));
+    detail::SplitFields(line, header.data(), header.size(), schema_.delimiter);
+
+    resolved = true;
+    for (std::size_t field = 0; resolved && field < NUM_FIELDS; ++field)
+    {
+      if (!columns[field]->name.empty())
+      {
+        const auto it = std::find(header.begin(), header.end(), columns[field]->name);
+        plan.index[field] = static_cast<std::size_t>(it - header.begin());
+        resolved = it != header.end();
+      }
+    }
+  }
+
+  if (!resolved)
+  {
+    spdlog::error(ErrorCode("Importer::ParseContents() failed",
+                            {{"schema", ErrorCode(schema_.name)}, {"error", ErrorCode("Header not found")}}));
+    return th;
+  }
+
+  for (std::size_t field = 0; field < NUM_FIELDS; ++field)
+  {
+    if (columns[field]->index.has_value()) plan.index[field] = *columns[field]->index;
+    if (!columns[field]->IsMapped()) plan.index[field] = kUnmapped;
+    if (plan.index[field] != kUnmapped) plan.split_fields = std::max(plan.split_fields, plan.index[field] + 1);
+  }
+  plan.split_fields = std::max(plan.split_fields, schema_.num_fields);
+
+  // If the bytes imported before are unchanged, only the rest of the section is parsed.
+  const auto section = data.substr(std::min(section_begin, data.size()));
+  std::size_t rows_begin = 0;
+  std::size_t rows_end = section.size();
+  bool skipped_imported = false;
+  if (source != nullptr && source->imported_size != 0 && source->imported_size <= section.size())
+  {
+    const auto imported_begin = schema_.newest_first ? section.size() - source->imported_size : 0;
+    if (Fnv1a(section.substr(imported_begin, source->imported_size)) == source->imported_hash)
+    {
+      if (schema_.newest_first)
+        rows_end = imported_begin;
+      else
+        rows_begin = source->imported_size;
+      skipped_imported = true;
+    }
+  }
+
+  // Rows are tokenized and parsed on a thread per chunk, one window of chunks at a time. The rows of a window are
+  // added to the history before the next window is parsed, so the staged rows take constant memory.
+  const auto rows_data = section.substr(rows_begin, rows_end - rows_begin);
+  const auto window_bytes = std::max<std::size_t>(min_chunk_bytes, 1) * detail::NumThreads();
+  const auto parse_window = [&](std::size_t begin, std::size_t end, bool stage_rows) {
+    const ChunkParser parser(schema_, plan, rows_data, stage_rows);
+    return detail::ParallelChunks(end - begin, min_chunk_bytes, [&parser, begin](std::size_t b, std::size_t e) {
+      return parser(begin + b, begin + e);
+    });
+  };
+
+  std::unordered_map<uint64_t, uint32_t> seen;
+  std::unordered_map<uint64_t, uint32_t> added;
+  std::size_t num_added = 0;
+  const auto add = [&](const Row& row) {
+    // Unless the imported rows were skipped, each row counts against the rows imported with the same fingerprint.
+    if (source != nullptr && !skipped_imported)
+    {
+      const auto it = source->rows.find(row.fingerprint);
+      if (++seen[row.fingerprint] <= (it == source->rows.end() ? 0 : it->second)) return;
+    }
+    if (row.error) std::rethrow_exception(row.error);
+    if (source != nullptr) ++added[row.fingerprint];
+
+    Transaction::Tags tags;
+    if (plan.index[ACCOUNT] != kUnmapped) tags.Add(schema_.account_tag, row.account);
+
+    // Symbols are interned straight from the export, so only new ones are copied.
+    const auto symbol = InternedSymbol::FromId(SymbolTable::Intern(row.symbol));
+    auto tr_id = th.Add(row.date, symbol, row.type, row.price, row.quantity, row.fee, std::move(tags));
+    spdlog::info("Parsed new transaction with id {0}", tr_id);
+    ++num_added;
+  };
+
+  std::optional<std::size_t> first_row;    // The offset of the first transaction in rows_data.
+  std::optional<std::size_t> section_end;  // The offset of the first row after the transactions, if any.
+  try
+  {
+    // The transactions end at the first row after them that does not have their shape, which may be in a later
+    // chunk. Rows are added as they are found, unless they are newest first, in which case this only finds the
+    // transactions without staging their rows.
+    bool done = false;
+    for (std::size_t begin = 0; !done && begin < rows_data.size(); begin += window_bytes)
+    {
+      const auto chunks = parse_window(begin, std::min(begin + window_bytes, rows_data.size()), !schema_.newest_first);
+      for (auto chunk = chunks.begin(); !done && chunk != chunks.end(); ++chunk)
+      {
+        std::optional<std::size_t> end = chunk->first_other;
+        if (!first_row.has_value())
+        {
+          // If the transactions continue the imported rows at the beginning of the section, they have to start right
+          // away.
+          const bool starts_other = chunk->first_other.has_value() &&
+                                    (!chunk->first_row.has_value() || *chunk->first_other < *chunk->first_row);
+          if (skipped_imported && !schema_.newest_first && starts_other)
+          {
+            done = true;
+            break;
+          }
+          if (!chunk->first_row.has_value()) continue;
+
+          first_row = chunk->first_row;
+          end = chunk->end;
+        }
+
+        for (const auto& row : chunk->rows)
+          if (!end.has_value() || row.offset < *end) add(row);
+        section_end = end;
+        done = end.has_value();
+      }
+    }
+
+    // Rows that are newest first are parsed again, a window at a time from the end, and added from the end of the
+    // file, as they always have been.
+    if (schema_.newest_first && first_row.has_value())
+    {
+      for (auto window_end = section_end.value_or(rows_data.size()); window_end > *first_row;)
+      {
+        const auto window_begin = window_end - std::min(window_bytes, window_end - *first_row);
+        const auto chunks = parse_window(window_begin, window_end, true);
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk)
+          for (auto row = chunk->rows.rbegin(); row != chunk->rows.rend(); ++row) add(*row);
+        window_end = window_begin;
+      }
+    }
+  }
+  catch (const std::exception& e)
+  {
+    // Nothing is imported unless every row is valid, so the transactions added so far are released.
+    for (const auto& [date, ids] : th)
+      for (const auto id : ids) TransactionPool::Release(id);
+    spdlog::error(ErrorCode("Importer::ParseContents() failed",
+                            {{"schema", ErrorCode(schema_.name)}, {"error", ErrorCode(e.what())}}));
+    return TransactionHistory(TransactionHistory::kTempTag);
+  }
+
+  if (source != nullptr)
+  {
+    for (const auto& [fingerprint, count] : added) source->rows[fingerprint] += count;
+
+    // The imported bytes grow to cover the new rows.
+    if (first_row.has_value())
+    {
+      const auto imported_begin = schema_.newest_first ? rows_begin + *first_row : 0;
+      const auto imported_end =
+          schema_.newest_first ? section.size() : rows_begin + section_end.value_or(rows_data.size());
+      source->imported_size = imported_end - imported_begin;
+      source->imported_hash = Fnv1a(section.substr(imported_begin, source->imported_size));
+    }
+  }
+
+  spdlog::info("Parsed {0} transactions", num_added);
+  return th;
+}
+}  // namespace inv::import
@@ -0,0 +1,185 @@
+/**
+ * @file importer.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "invport/detail/file_serializable.h"
+#include "invport/detail/transaction_history.h"
+
+/**
+ * Contains the engine that imports transactions from broker exports.
+ *
+ * A broker's format is described by a Schema, which maps the fields of a transaction to columns of the export. The
+ * schema is compiled once into an Importer, which tokenizes and parses exports on all cores without any code specific
+ * to the broker.
+ */
+namespace inv::import
+{
+/**
+ * A column of an export, either by its header name or by its zero-based index. A default column is not in the export.
+ */
+struct Column
+{
+  Column() = default;
+  Column(int column_index) : Column(static_cast<std::size_t>(column_index)) {}  // NOLINT
+  Column(std::size_t column_index) : index(column_index) {}                     // NOLINT
+  Column(const char* column_name) : name(column_name) {}                        // NOLINT
+  Column(std::string column_name) : name(std::move(column_name)) {}             // NOLINT
+
+  [[nodiscard]] bool IsMapped() const noexcept { return index.has_value() || !name.empty(); }
+
+  std::optional<std::size_t> index;
+  std::string name;
+};
+
+/**
+ * The minimum number of bytes per parsing thread, so that small exports are parsed on the calling thread alone.
+ */
+constexpr std::size_t kMinChunkBytes = 1 << 20;
+
+/**
+ * Describes the transactions section of a broker's export.
+ *
+ * If any column is named, the section starts after the first row that contains every named column. Otherwise, it
+ * starts at the beginning of the export. The transactions are the first run of rows with the shape of a transaction
+ * in the section, which ends at the next non-empty row that does not have it.
+ */
+struct Schema
+{
+  std::string name;
+  char delimiter = ',';
+
+  Column date;
+  Column symbol;
+  Column type;
+  Column quantity;
+  Column price;
+  Column fee;      // Optional. Transactions have no fee if the export does not have it.
+  Column account;  // Optional. Its value is tagged with account_tag.
+
+  /**
+   * Optional. Checked to be a valid date in date_format, like the date, but not imported.
+   */
+  Column settlement_date;
+
+  Date::Format date_format = Date::Format::MMDDYYYY;
+
+  /**
+   * The values of the type column that are imported. Rows of other types, such as dividends, are skipped.
+   */
+  std::vector<std::pair<std::string, TransactionHistory::Transaction::Type>> types;
+
+  std::string account_tag;
+
+  /**
+   * The number of fields in each row, including empty trailing ones. If zero, rows only need the mapped columns.
+   */
+  std::size_t num_fields = 0;
+
+  bool negative_sells = false;    // Whether sells have negative quantities, which are negated when imported.
+  bool newest_first = false;      // Whether rows are in reverse date order, so they are imported from the end.
+  bool numeric_accounts = false;  // Whether accounts are numbers, which are tagged without their leading zeros.
+};
+
+/**
+ * What has already been imported from an export, so that importing it again only parses and adds its new rows.
+ *
+ * Exports only grow, so the rows imported before are usually still in the export as the same bytes: at the end of
+ * the section if the schema is newest first, and at the beginning otherwise. If those bytes are unchanged, they are
+ * skipped without being parsed. Otherwise, the whole export is parsed, and rows are skipped by their fingerprints.
+ */
+struct Source
+{
+  uint64_t imported_hash = 0;     // The hash of the imported bytes of the section.
+  std::size_t imported_size = 0;  // The size of the imported bytes of the section, or zero if none were imported.
+
+  /**
+   * The number of imported rows with each fingerprint, which is the hash of the row's text. Identical rows, such as
+   * two equal trades on the same day, are counted separately.
+   */
+  std::unordered_map<uint64_t, uint32_t> rows;
+};
+
+/**
+ * Imports transactions from exports described by a schema.
+ */
+class Importer
+{
+ public:
+  /**
+   * Compiles the given schema.
+   * @param schema the schema of the exports. Throws std::invalid_argument if a required column is missing, if it has
+   * no types, if it has an account column without an account tag, or numeric accounts without an account column.
+   */
+  explicit Importer(Schema schema);
+
+  /**
+   * Parses the transactions of the export at the given path. Errors are logged, and leave the history empty.
+   *
+   * The section is split into chunks at row boundaries, which are tokenized and parsed on a thread each, one window
+   * of a chunk per hardware thread at a time. The rows of each window are added to the history on the calling thread,
+   * in the same order as a single-threaded parse, before the next window is parsed. Staged rows thus take memory in
+   * proportion to the window rather than to the export. Exports that are newest first are scanned once to find their
+   * transactions, which are then parsed a window at a time from the end.
+   * @param path the export to parse
+   * @param min_chunk_bytes the minimum number of bytes per thread
+   * @return a temporary history of the transactions
+   */
+  [[nodiscard]] TransactionHistory Parse(const file::Path& path, std::size_t min_chunk_bytes = kMinChunkBytes) const;
+
+  /**
+   * Parses the transactions of the given export contents.
+   * @see Parse(const file::Path&, std::size_t)
+   */
+  [[nodiscard]] TransactionHistory ParseContents(std::string_view data,
+                                                 std::size_t min_chunk_bytes = kMinChunkBytes) const;
+
+  /**
+   * Parses the transactions of the export at the given path that have not been imported from it yet, and records
+   * them in source.
+   * @see Parse(const file::Path&, std::size_t)
+   * @param path the export to parse
+   * @param source what has been imported from the export
+   * @param min_chunk_bytes the minimum number of bytes per thread
+   * @return a temporary history of the new transactions
+   */
+  [[nodiscard]] TransactionHistory Parse(const file::Path& path, Source& source,
+                                         std::size_t min_chunk_bytes = kMinChunkBytes) const;
+
+  /**
+   * Parses the transactions of the given export contents that have not been imported yet, and records them in source.
+   * @see Parse(const file::Path&, Source&, std::size_t)
+   */
+  [[nodiscard]] TransactionHistory ParseContents(std::string_view data, Source& source,
+                                                 std::size_t min_chunk_bytes = kMinChunkBytes) const;
+
+  [[nodiscard]] const Schema& GetSchema() const noexcept { return schema_; }
+
+ private:
+  /**
+   * Parses the export at the given path. If source is null, every transaction is parsed.
+   */
+  [[nodiscard]] TransactionHistory Import(const file::Path& path, Source* source, std::size_t min_chunk_bytes) const;
+
+  /**
+   * Parses the given export contents. If source is null, every transaction is parsed.
+   */
+  [[nodiscard]] TransactionHistory ImportContents(std::string_view data, Source* source,
+                                                  std::size_t min_chunk_bytes) const;
+
+  Schema schema_;
+  bool has_header_ = false;  // Whether any column is named, so the section starts after a header row.
+};
+}  // namespace inv::import
@@ -0,0 +1,119 @@
+/**
+ * @file journal.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/journal.h"
+
+#include <spdlog/spdlog.h>
+
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace inv::detail
+{
+namespace
+{
+constexpr json::MemberName kJsonBaseKey = "base";
+constexpr json::MemberName kJsonIdKey = "id";
+constexpr json::MemberName kJsonOperationKey = "operation";
+constexpr json::MemberName kJsonTransactionKey = "transaction";
+}  // namespace
+
+ValueWithErrorCode<std::vector<Journal::Record>> Journal::Load(const uint64_t base_hash)
+{
+  auto [file, ec] = MapFile();
+  if (ec.Failure()) return {{}, ErrorCode("Journal::Load() failed", std::move(ec))};
+
+  const auto contents = file.View();
+  std::vector<Record> records;
+  try
+  {
+    const auto header_end = contents.find('\n');
+    std::optional<uint64_t> id;
+    if (header_end != std::string_view::npos)
+    {
+      const auto header = json::Json::parse(contents.begin(), contents.begin() + header_end);
+      if (header.value(kJsonBaseKey, uint64_t(0)) == base_hash && header.contains(kJsonIdKey))
+        id = header[kJsonIdKey].get<uint64_t>();
+    }
+    if (!id.has_value())
+    {
+      if (!contents.empty()) spdlog::warn("Discarding journal that does not match its base file");
+
+      std::random_device random;
+      id_ = (uint64_t{random()} << 32) | random();
+      ec = Reset(base_hash);
+      if (ec.Failure()) return {{}, ErrorCode("Journal::Load() failed", std::move(ec))};
+      return {{}, {}};
+    }
+    id_ = *id;
+
+    for (auto begin = header_end + 1, end = contents.find('\n', begin); end != std::string_view::npos;
+         begin = end + 1, end = contents.find('\n', begin))
+    {
+      const auto j_record = json::Json::parse(contents.begin() + begin, contents.begin() + end);
+      records.push_back({j_record[kJsonOperationKey].get<Operation>(), j_record[kJsonTransactionKey]});
+    }
+  }
+  catch (const std::exception& e)
+  {
+    return {{}, ErrorCode("Journal::Load() failed", ErrorCode(e.what()))};
+  }
+
+  // Drop a torn final record, so that the next append starts on a fresh line.
+  if (const auto last_end = contents.rfind('\n'); last_end + 1 != contents.size())
+  {
+    spdlog::warn("Discarding incomplete journal record");
+    ec = WriteFile(std::string(contents.substr(0, last_end + 1)));
+    if (ec.Failure()) return {{}, ErrorCode("Journal::Load() failed", std::move(ec))};
+  }
+
+  size_ = records.size();
+  return {std::move(records), {}};
+}
+
+ErrorCode Journal::Append(const std::vector<Record>& records)
+{
+  if (records.empty()) return {};
+
+  std::string contents;
+  try
+  {
+    for (const auto& record : records)
+    {
+      json::Json j_record;
+      j_record[kJsonOperationKey] = record.operation;
+      j_record[kJsonTransactionKey] = record.transaction;
+      contents += j_record.dump();
+      contents += '\n';
+    }
+  }
+  catch (const std::exception& e)
+  {
+    return ErrorCode("Journal::Append() failed", ErrorCode(e.what()));
+  }
+
+  auto ec = AppendFile(std::move(contents));
+  if (ec.Failure()) return ErrorCode("Journal::Append() failed", std::move(ec));
+
+  size_ += records.size();
+  return {};
+}
+
+ErrorCode Journal::Reset(const uint64_t base_hash)
+{
+  json::Json header;
+  header[kJsonBaseKey] = base_hash;
+  header[kJsonIdKey] = id_;
+
+  auto ec = WriteFile(header.dump() + '\n');
+  if (ec.Failure()) return ErrorCode("Journal::Reset() failed", std::move(ec));
+
+  size_ = 0;
+  return {};
+}
+}  // namespace inv::detail
@@ -0,0 +1,86 @@
+/**
+ * @file journal.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "invport/detail/common.h"
+#include "invport/detail/file_serializable.h"
+
+namespace inv::detail
+{
+/**
+ * An append-only log of edits to a file, stored as JSON lines next to it.
+ *
+ * Appending a record costs O(record) regardless of the size of the base file, so an edit no longer requires rewriting
+ * everything. The first line is a header holding the hash of the base file the records apply to. If the base file is
+ * rewritten but the journal is not reset, such as after a crash between the two, the stale records are discarded
+ * rather than replayed twice. A final record that was cut short by a crash has no newline and is ignored.
+ *
+ * The header also holds a random ID, which is kept when the journal is reset after its base file is rewritten, and
+ * replaced when a journal that does not match its base file is discarded. It thus identifies a base file across its
+ * rewrites, so that other files can tell whether they were written alongside it.
+ */
+class Journal : public file::FileIoBase
+{
+ public:
+  enum Operation
+  {
+    ADD,
+    REMOVE
+  };
+
+  struct Record
+  {
+    Operation operation;
+    json::Json transaction;
+  };
+
+  /**
+   * Creates a Journal for the base file with the given path. The journal's path is the same, but with the .jsonl
+   * extension.
+   */
+  Journal(const file::Path& relative_path, file::Directory directory)
+      : file::FileIoBase(relative_path, directory, file::JSONL)
+  {
+  }
+
+  /**
+   * Reads the records that apply to the given base file. If the journal is missing or belongs to another version of
+   * the base file, it is reset to be empty.
+   * @param base_hash Fnv1a hash of the base file's contents
+   * @return records in the order they were appended
+   */
+  [[nodiscard]] ValueWithErrorCode<std::vector<Record>> Load(uint64_t base_hash);
+
+  /**
+   * Appends records to the journal in a single write.
+   */
+  [[nodiscard]] ErrorCode Append(const std::vector<Record>& records);
+
+  /**
+   * Discards all records. Should be called after the base file has been rewritten.
+   * @param base_hash Fnv1a hash of the base file's new contents
+   */
+  [[nodiscard]] ErrorCode Reset(uint64_t base_hash);
+
+  /**
+   * Returns the number of records in the journal.
+   */
+  [[nodiscard]] std::size_t Size() const noexcept { return size_; }
+
+  /**
+   * Returns the ID of the base file, which is zero until the journal is loaded.
+   */
+  [[nodiscard]] uint64_t Id() const noexcept { return id_; }
+
+ private:
+  std::size_t size_ = 0;
+  uint64_t id_ = 0;
+};
+}  // namespace inv::detail
@@ -0,0 +1,341 @@
+/**
+ * @file json_reader.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/json_reader.h"
+
+#include <stdexcept>
+
+namespace inv::detail
+{
+namespace
+{
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+int HexValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+void AppendUtf8(std::string& out, uint32_t code_point)
+{
+  if (code_point < 0x80)
+  {
+    out.push_back(static_cast<char>(code_point));
+  }
+  else if (code_point < 0x800)
+  {
+    out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+  else if (code_point < 0x10000)
+  {
+    out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+  else
+  {
+    out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+}  // namespace
+
+JsonReader::Token JsonReader::Peek()
+{
+  const char c = SkipWhitespace();
+  if (pos_ >= input_.size()) return END;
+
+  switch (c)
+  {
+    case '[':
+      return BEGIN_ARRAY;
+    case ']':
+      return END_ARRAY;
+    case '{':
+      return BEGIN_OBJECT;
+    case '}':
+      return END_OBJECT;
+    case '"':
+      return STRING;
+    case 't':
+    case 'f':
+      return BOOLEAN;
+    case 'n':
+      return NULL_VALUE;
+    default:
+      if (c == '-' || IsDigit(c)) return NUMBER;
+      Fail("unexpected character");
+  }
+}
+
+bool JsonReader::HasNext()
+{
+  if (empty_.empty()) Fail("not in an array or object");
+
+  const char c = SkipWhitespace();
+  if (c == ']' || c == '}') return false;
+
+  if (!empty_.back()) Expect(',', "',' or closing bracket");
+  empty_.back() = false;
+  return true;
+}
+
+std::string_view JsonReader::Key()
+{
+  const auto key = ReadString();
+  SkipWhitespace();
+  Expect(':', "':'");
+  return key;
+}
+
+std::string_view JsonReader::String() { return ReadString(); }
+
+bool JsonReader::Boolean()
+{
+  const char c = SkipWhitespace();
+  if (c == 't')
+  {
+    ReadLiteral("true");
+    return true;
+  }
+  if (c == 'f')
+  {
+    ReadLiteral("false");
+    return false;
+  }
+  Fail("expected boolean");
+}
+
+bool JsonReader::SkipNull()
+{
+  if (SkipWhitespace() != 'n') return false;
+  ReadLiteral("null");
+  return true;
+}
+
+void JsonReader::Skip()
+{
+  switch (Peek())
+  {
+    case BEGIN_ARRAY:
+      BeginArray();
+      while (HasNext()) Skip();
+      EndArray();
+      break;
+    case BEGIN_OBJECT:
+      BeginObject();
+      while (HasNext())
+      {
+        static_cast<void>(Key());
+        Skip();
+      }
+      EndObject();
+      break;
+    case STRING:
+      ReadString();
+      break;
+    case NUMBER:
+      ReadNumber();
+      break;
+    case BOOLEAN:
+      static_cast<void>(Boolean());
+      break;
+    case NULL_VALUE:
+      SkipNull();
+      break;
+    default:
+      Fail("expected value");
+  }
+}
+
+void JsonReader::Finish()
+{
+  SkipWhitespace();
+  if (pos_ != input_.size()) Fail("unexpected data after document");
+}
+
+void JsonReader::Open(char bracket)
+{
+  if (empty_.size() >= kMaxDepth) Fail("nesting is too deep");
+
+  SkipWhitespace();
+  Expect(bracket, bracket == '[' ? "'['" : "'{'");
+  empty_.push_back(true);
+}
+
+void JsonReader::Close(char bracket)
+{
+  SkipWhitespace();
+  Expect(bracket, bracket == ']' ? "']'" : "'}'");
+  empty_.pop_back();
+}
+
+char JsonReader::SkipWhitespace()
+{
+  while (pos_ < input_.size())
+  {
+    const char c = input_[pos_];
+    if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return c;
+    ++pos_;
+  }
+  return '\0';
+}
+
+void JsonReader::Expect(char c, const char* expected)
+{
+  if (pos_ >= input_.size() || input_[pos_] != c) Fail(std::string("expected ") + expected);
+  ++pos_;
+}
+
+std::string_view JsonReader::ReadString()
+{
+  SkipWhitespace();
+  Expect('"', "string");
+
+  // Fast path: return a view if there is nothing to unescape.
+  const auto begin = pos_;
+  while (pos_ < input_.size())
+  {
+    const auto c = static_cast<unsigned char>(input_[pos_]);
+    if (c == '"')
+    {
+      ++pos_;
+      return input_.substr(begin, pos_ - 1 - begin);
+    }
+    if (c == '\\') break;
+    if (c < 0x20) Fail("unescaped control character in string");
+    ++pos_;
+  }
+
+  scratch_.assign(input_.substr(begin, pos_ - begin));
+  while (pos_ < input_.size())
+  {
+    const auto c = static_cast<unsigned char>(input_[pos_]);
+    if (c == '"')
+    {
+      ++pos_;
+      return scratch_;
+    }
+    if (c < 0x20) Fail("unescaped control character in string");
+    if (c != '\\')
+    {
+      scratch_.push_back(static_cast<char>(c));
+      ++pos_;
+      continue;
+    }
+
+    if (++pos_ >= input_.size()) break;
+    switch (input_[pos_++])
+    {
+      case '"':
+        scratch_.push_back('"');
+        break;
+      case '\\':
+        scratch_.push_back('\\');
+        break;
+      case '/':
+        scratch_.push_back('/');
+        break;
+      case 'b':
+        scratch_.push_back('\b');
+        break;
+      case 'f':
+        scratch_.push_back('\f');
+        break;
+      case 'n':
+        scratch_.push_back('\n');
+        break;
+      case 'r':
+        scratch_.push_back('\r');
+        break;
+      case 't':
+        scratch_.push_back('\t');
+        break;
+      case 'u':
+      {
+        const auto read_hex = [this]() {
+          if (pos_ + 4 > input_.size()) Fail("truncated unicode escape");
+          uint32_t value = 0;
+          for (int i = 0; i < 4; ++i)
+          {
+            const int digit = HexValue(input_[pos_++]);
+            if (digit < 0) Fail("invalid unicode escape", pos_ - 1);
+            value = value << 4 | static_cast<uint32_t>(digit);
+          }
+          return value;
+        };
+
+        uint32_t code_point = read_hex();
+        if (code_point >= 0xD800 && code_point <= 0xDBFF)
+        {
+          if (input_.substr(pos_, 2) != "\\u") Fail("unpaired surrogate in unicode escape");
+          pos_ += 2;
+          const uint32_t low = read_hex();
+          if (low < 0xDC00 || low > 0xDFFF) Fail("unpaired surrogate in unicode escape");
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        }
+        else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+        {
+          Fail("unpaired surrogate in unicode escape");
+        }
+        AppendUtf8(scratch_, code_point);
+        break;
+      }
+      default:
+        Fail("invalid escape", pos_ - 1);
+    }
+  }
+  Fail("unterminated string");
+}
+
+std::string_view JsonReader::ReadNumber()
+{
+  SkipWhitespace();
+  const auto begin = pos_;
+  const auto digits = [this]() {
+    const auto start = pos_;
+    while (pos_ < input_.size() && IsDigit(input_[pos_])) ++pos_;
+    return pos_ - start;
+  };
+
+  if (pos_ < input_.size() && input_[pos_] == '-') ++pos_;
+  const auto int_begin = pos_;
+  const auto int_digits = digits();
+  if (int_digits == 0) Fail("expected number", begin);
+  if (int_digits > 1 && input_[int_begin] == '0') Fail("leading zero in number", begin);
+
+  if (pos_ < input_.size() && input_[pos_] == '.')
+  {
+    ++pos_;
+    if (digits() == 0) Fail("expected digit after decimal point");
+  }
+  if (pos_ < input_.size() && (input_[pos_] == 'e' || input_[pos_] == 'E'))
+  {
+    ++pos_;
+    if (pos_ < input_.size() && (input_[pos_] == '+' || input_[pos_] == '-')) ++pos_;
+    if (digits() == 0) Fail("expected digit in exponent");
+  }
+  return input_.substr(begin, pos_ - begin);
+}
+
+void JsonReader::ReadLiteral(std::string_view literal)
+{
+  if (input_.substr(pos_, literal.size()) != literal) Fail("expected " + std::string(literal));
+  pos_ += literal.size();
+}
+
+void JsonReader::Fail(const std::string& error, std::size_t offset) const
+{
+  throw std::runtime_error(
+      ErrorCode("JsonReader failed", {{"offset", ErrorCode(std::to_string(offset))}, {"error", ErrorCode(error)}}));
+}
+}  // namespace inv::detail
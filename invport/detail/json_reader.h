@@ -0,0 +1,167 @@
+/**
+ * @file json_reader.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "invport/detail/common.h"
+
+namespace inv::detail
+{
+/**
+ * Reads JSON text one value at a time, without building a DOM.
+ *
+ * The caller drives the reader in the shape of the document it expects, for example:
+ *
+ *   reader.BeginObject();
+ *   while (reader.HasNext())
+ *   {
+ *     const auto key = reader.Key();
+ *     if (key == "price") price = reader.Number<double>();
+ *     else reader.Skip();
+ *   }
+ *   reader.EndObject();
+ *
+ * Strings are returned as views into the input, unless they contain escapes, in which case they are decoded into a
+ * scratch buffer that is only valid until the next call. Any syntax error or unexpected value throws a
+ * std::runtime_error whose message holds the byte offset of the error.
+ */
+class JsonReader
+{
+ public:
+  /**
+   * The maximum nesting depth of arrays and objects, which bounds the recursion of Skip().
+   */
+  static constexpr const std::size_t kMaxDepth = 256;
+
+  enum Token
+  {
+    BEGIN_ARRAY,
+    END_ARRAY,
+    BEGIN_OBJECT,
+    END_OBJECT,
+    STRING,
+    NUMBER,
+    BOOLEAN,
+    NULL_VALUE,
+    END
+  };
+
+  explicit JsonReader(std::string_view input) : input_(input) {}
+
+  /**
+   * Returns the kind of the next token without consuming it. An array's or object's separating commas are not tokens.
+   */
+  [[nodiscard]] Token Peek();
+
+  void BeginArray() { Open('['); }
+  void EndArray() { Close(']'); }
+  void BeginObject() { Open('{'); }
+  void EndObject() { Close('}'); }
+
+  /**
+   * Returns whether the current array or object has another element, consuming the comma before it if needed.
+   */
+  [[nodiscard]] bool HasNext();
+
+  /**
+   * Reads an object member's key. The next value read is the member's value.
+   */
+  [[nodiscard]] std::string_view Key();
+
+  [[nodiscard]] std::string_view String();
+
+  /**
+   * Reads an integral, floating point or decimal number. Decimals are read exactly, except for those with an exponent,
+   * such as 1e-05, which are rounded from the nearest floating point number.
+   */
+  template <typename T>
+  [[nodiscard]] T Number()
+  {
+    const auto token = ReadNumber();
+    const char* const end = token.data() + token.size();
+
+    T value{};
+    std::from_chars_result result{};
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+      result = std::from_chars(token.data(), end, value);
+    }
+    else
+    {
+      result = T::FromChars(token, value);
+      if (result.ec == std::errc() && result.ptr != end)
+      {
+        double approximate = 0;
+        result = std::from_chars(token.data(), end, approximate);
+        if (result.ec == std::errc() && result.ptr == end) value = T(approximate);
+      }
+    }
+    if (result.ec != std::errc() || result.ptr != end)
+      Fail("invalid number for its type", token.data() - input_.data());
+    return value;
+  }
+
+  [[nodiscard]] bool Boolean();
+
+  /**
+   * Consumes the next value if it is null.
+   * @return whether it was null
+   */
+  bool SkipNull();
+
+  /**
+   * Consumes the next value, including any nested values.
+   */
+  void Skip();
+
+  /**
+   * Checks that nothing but whitespace follows the document.
+   */
+  void Finish();
+
+  /**
+   * Returns the byte offset of the next unread character.
+   */
+  [[nodiscard]] std::size_t Offset() const noexcept { return pos_; }
+
+ private:
+  void Open(char bracket);
+  void Close(char bracket);
+
+  /**
+   * Skips whitespace and returns the next character, or '\0' at the end of input.
+   */
+  char SkipWhitespace();
+
+  /**
+   * Consumes the given character, or fails with the given description of what was expected.
+   */
+  void Expect(char c, const char* expected);
+
+  std::string_view ReadString();
+  std::string_view ReadNumber();
+  void ReadLiteral(std::string_view literal);
+
+  [[noreturn]] void Fail(const std::string& error, std::size_t offset) const;
+  [[noreturn]] void Fail(const std::string& error) const { Fail(error, pos_); }
+
+  std::string_view input_;
+  std::size_t pos_ = 0;
+  std::string scratch_;
+
+  /**
+   * One entry per open array or object: whether it has no elements yet.
+   */
+  std::vector<bool> empty_;
+};
+}  // namespace inv::detail
@@ -0,0 +1,129 @@
+/**
+ * @file json_writer.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/json_writer.h"
+
+namespace inv::detail
+{
+JsonWriter::JsonWriter(std::ostream& out, std::size_t buffer_size) : stream_(&out), buffer_size_(buffer_size)
+{
+  buffer_.reserve(buffer_size_);
+}
+
+JsonWriter::JsonWriter(std::string& out, std::size_t buffer_size) : string_(&out), buffer_size_(buffer_size)
+{
+  buffer_.reserve(buffer_size_);
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key)
+{
+  String(key);
+  Put(':');
+  after_key_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view str)
+{
+  static constexpr const char kHex[] = "0123456789abcdef";
+
+  BeginValue();
+  Put('"');
+
+  // Copy runs of characters that need no escaping in one go.
+  std::size_t run_begin = 0;
+  for (std::size_t i = 0; i < str.size(); ++i)
+  {
+    const auto c = static_cast<unsigned char>(str[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    Put(str.substr(run_begin, i - run_begin));
+    run_begin = i + 1;
+    switch (c)
+    {
+      case '"':
+        Put("\\\"");
+        break;
+      case '\\':
+        Put("\\\\");
+        break;
+      case '\b':
+        Put("\\b");
+        break;
+      case '\f':
+        Put("\\f");
+        break;
+      case '\n':
+        Put("\\n");
+        break;
+      case '\r':
+        Put("\\r");
+        break;
+      case '\t':
+        Put("\\t");
+        break;
+      default:
+        const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+        Put(std::string_view(escaped, sizeof(escaped)));
+        break;
+    }
+  }
+  Put(str.substr(run_begin));
+
+  Put('"');
+  return *this;
+}
+
+ErrorCode JsonWriter::Flush()
+{
+  WriteBuffer();
+  if (stream_ == nullptr) return {};
+
+  stream_->flush();
+  if (!*stream_) return ErrorCode("JsonWriter::Flush() failed");
+  return {};
+}
+
+JsonWriter& JsonWriter::Open(char bracket)
+{
+  BeginValue();
+  Put(bracket);
+  empty_.push_back(true);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Close(char bracket)
+{
+  Put(bracket);
+  empty_.pop_back();
+  return *this;
+}
+
+void JsonWriter::BeginValue()
+{
+  if (after_key_)
+  {
+    after_key_ = false;
+    return;
+  }
+  if (empty_.empty()) return;
+
+  if (!empty_.back()) Put(',');
+  empty_.back() = false;
+}
+
+void JsonWriter::WriteBuffer()
+{
+  if (buffer_.empty()) return;
+
+  hash_ = Fnv1a(buffer_, hash_);
+  if (stream_ != nullptr)
+    stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  else
+    string_->append(buffer_);
+  buffer_.clear();
+}
+}  // namespace inv::detail
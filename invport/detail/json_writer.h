@@ -0,0 +1,136 @@
+/**
+ * @file json_writer.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "invport/detail/common.h"
+#include "invport/detail/utils.h"
+
+namespace inv::detail
+{
+/**
+ * Writes JSON text to a stream or a string as it is produced, without building a DOM.
+ *
+ * Output is staged in a fixed-size buffer that is written out whenever it fills, so memory use beyond the output does
+ * not depend on the size of the document. Commas and colons are inserted automatically. The writer does not check that
+ * the calls form valid JSON, such as that every object member has a key.
+ */
+class JsonWriter
+{
+ public:
+  static constexpr const std::size_t kDefaultBufferSize = 64 * 1024;
+
+  /**
+   * @param out the stream to write to
+   * @param buffer_size the number of bytes to stage before writing to out
+   */
+  explicit JsonWriter(std::ostream& out, std::size_t buffer_size = kDefaultBufferSize);
+
+  /**
+   * @param out the string to append to, which holds the only copy of the output
+   * @param buffer_size the number of bytes to stage before appending to out
+   */
+  explicit JsonWriter(std::string& out, std::size_t buffer_size = kDefaultBufferSize);
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  JsonWriter& BeginArray() { return Open('['); }
+  JsonWriter& EndArray() { return Close(']'); }
+  JsonWriter& BeginObject() { return Open('{'); }
+  JsonWriter& EndObject() { return Close('}'); }
+
+  /**
+   * Writes an object member's key. The next value written is the member's value.
+   */
+  JsonWriter& Key(std::string_view key);
+
+  JsonWriter& String(std::string_view str);
+
+  /**
+   * Writes an integral, floating point or decimal number. Floating point numbers use the shortest representation that
+   * round trips, and decimals are written exactly. Non-finite numbers have no JSON representation and are written as
+   * null.
+   */
+  template <typename T>
+  JsonWriter& Number(T value)
+  {
+    BeginValue();
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      if (!std::isfinite(value))
+      {
+        Put("null");
+        return *this;
+      }
+    }
+
+    char chars[32];
+    std::to_chars_result result{};
+    if constexpr (std::is_arithmetic_v<T>)
+      result = std::to_chars(chars, chars + sizeof(chars), value);
+    else
+      result = value.ToChars(chars, chars + sizeof(chars));
+    Put(std::string_view(chars, result.ptr - chars));
+    return *this;
+  }
+
+  /**
+   * Writes any staged output to the stream or string.
+   * @return ErrorCode denoting success or failure of every write so far
+   */
+  [[nodiscard]] ErrorCode Flush();
+
+  /**
+   * Returns the Fnv1a hash of everything flushed so far.
+   */
+  [[nodiscard]] uint64_t Hash() const noexcept { return hash_; }
+
+ private:
+  JsonWriter& Open(char bracket);
+  JsonWriter& Close(char bracket);
+
+  /**
+   * Writes the separator that must precede a value, if any.
+   */
+  void BeginValue();
+
+  void Put(char c)
+  {
+    buffer_.push_back(c);
+    if (buffer_.size() >= buffer_size_) WriteBuffer();
+  }
+
+  void Put(std::string_view str)
+  {
+    buffer_.append(str);
+    if (buffer_.size() >= buffer_size_) WriteBuffer();
+  }
+
+  void WriteBuffer();
+
+  std::ostream* stream_ = nullptr;
+  std::string* string_ = nullptr;
+  const std::size_t buffer_size_;
+  std::string buffer_;
+  uint64_t hash_ = Fnv1a({});
+
+  /**
+   * One entry per open array or object: whether it has no elements yet.
+   */
+  std::vector<bool> empty_;
+  bool after_key_ = false;
+};
+}  // namespace inv::detail
@@ -6,7 +6,9 @@
 
 #include "invport/detail/keychain.h"
 
+#include <algorithm>
 #include <cctype>
+#include <iterator>
 #include <utility>
 
 #include "invport/detail/env.h"
@@ -89,14 +91,15 @@ Keychain::Keychain(const EnvironmentFlag&)
 Keychain::Keychain(file::Directory directory)
     : file::FileIoBase("keychain", directory), key_location_(KeyLocation::FILE)
 {
-  auto response = ReadFile();
+  auto response = MapFile();
   if (response.second.Failure())
   {
     ec_ = {"Keychain::Keychain() failed", std::move(response.second)};
   }
-  else if (!response.first.empty())
+  else if (!response.first.View().empty())
   {
-    ec_ = Deserialize(json::Json::parse(response.first));
+    detail::JsonReader reader(response.first.View());
+    ec_ = Deserialize(reader);
   }
 }
 
@@ -217,6 +220,60 @@ ErrorCode Keychain::Deserialize(const json::Json& input_json)
   }
 }
 
+ErrorCode Keychain::Deserialize(detail::JsonReader& reader)
+{
+  try
+  {
+    if (reader.SkipNull())
+    {
+      reader.Finish();
+      return {};
+    }
+
+    Key keys[NUM_KEYS];
+    bool found[NUM_KEYS]{};
+    reader.BeginObject();
+    while (reader.HasNext())
+    {
+      const auto name = reader.Key();
+      const auto* const it = std::find(std::begin(kKeyNameMap), std::end(kKeyNameMap), name);
+      if (it != std::end(kKeyNameMap))
+      {
+        keys[it - std::begin(kKeyNameMap)] = reader.String();
+        found[it - std::begin(kKeyNameMap)] = true;
+      }
+      else
+      {
+        reader.Skip();
+      }
+    }
+    reader.EndObject();
+    reader.Finish();
+
+    for (int i = 0; i < NUM_KEYS; ++i)
+    {
+      if (!found[i])
+      {
+        return {"Keychain::Deserialize() failed", ErrorCode("Missing key", {"type", ErrorCode(kKeyNameMap[i])})};
+      }
+    }
+
+    for (int i = 0; i < NUM_KEYS; ++i)
+    {
+      auto ec = Set(static_cast<KeyType>(i), keys[i], false);
+      if (ec.Failure())
+      {
+        return {"Keychain::Deserialize() failed", std::move(ec)};
+      }
+    }
+    return {};
+  }
+  catch (const std::exception& e)
+  {
+    return {"Keychain::Deserialize() failed", ErrorCode{e.what()}};
+  }
+}
+
 // endregion Serialization
 
 }  // namespace inv::key
@@ -11,6 +11,7 @@
 #include <string>
 
 #include "invport/detail/file_serializable.h"
+#include "invport/detail/json_reader.h"
 
 /**
  * Contains methods and classes for reading and writing IEX API keys.
@@ -97,6 +98,11 @@ class Keychain : private file::FileIoBase, private iex::json::JsonBidirectionalS
 
   ErrorCode Deserialize(const iex::json::Json& input_json) final;
 
+  /**
+   * Reads the keys from the reader's next JSON object, without building it in memory.
+   */
+  ErrorCode Deserialize(detail::JsonReader& reader);
+
   enum KeyLocation
   {
     ENVIRONMENT,
@@ -0,0 +1,75 @@
+/**
+ * @file parallel.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace inv::detail
+{
+/**
+ * Returns the number of hardware threads, or one if it is not known.
+ */
+inline std::size_t NumThreads() { return std::max(1U, std::thread::hardware_concurrency()); }
+
+/**
+ * Returns the number of chunks that ParallelChunks splits count elements into: one per hardware thread, but no more
+ * than leaves each chunk at least min_chunk_size elements.
+ */
+inline std::size_t NumChunks(std::size_t count, std::size_t min_chunk_size)
+{
+  const std::size_t max_chunks = count / std::max<std::size_t>(min_chunk_size, 1);
+  return std::max<std::size_t>(1, std::min(NumThreads(), max_chunks));
+}
+
+/**
+ * Splits [0, count) into contiguous chunks and calls fn(begin, end) for each chunk on its own thread. The calling
+ * thread processes the first chunk itself.
+ *
+ * If any call throws, the exception of the first such chunk is rethrown after every chunk has finished.
+ * @param count the number of elements
+ * @param min_chunk_size the minimum number of elements per chunk, so small inputs are not split up
+ * @param fn callable that takes the half-open element range of a chunk
+ * @return the results of fn, in chunk order
+ */
+template <typename F>
+auto ParallelChunks(std::size_t count, std::size_t min_chunk_size, F&& fn)
+    -> std::vector<std::invoke_result_t<F&, std::size_t, std::size_t>>
+{
+  using Result = std::invoke_result_t<F&, std::size_t, std::size_t>;
+
+  const auto num_chunks = NumChunks(count, min_chunk_size);
+  const auto chunk_begin = [count, num_chunks](std::size_t chunk) { return count * chunk / num_chunks; };
+
+  std::vector<std::future<Result>> futures;
+  futures.reserve(num_chunks - 1);
+  for (std::size_t chunk = 1; chunk < num_chunks; ++chunk)
+    futures.push_back(std::async(std::launch::async, std::ref(fn), chunk_begin(chunk), chunk_begin(chunk + 1)));
+
+  std::vector<Result> results;
+  results.reserve(num_chunks);
+  try
+  {
+    results.push_back(fn(0, chunk_begin(1)));
+  }
+  catch (...)
+  {
+    // The other chunks reference the caller's state, so they must finish before unwinding.
+    for (auto& future : futures) future.wait();
+    throw;
+  }
+
+  for (auto& future : futures) future.wait();
+  for (auto& future : futures) results.push_back(future.get());
+  return results;
+}
+}  // namespace inv::detail
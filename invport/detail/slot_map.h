@@ -0,0 +1,205 @@
+/**
+ * @file slot_map.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace inv::detail
+{
+/**
+ * A slot map with generational handles.
+ *
+ * Values are stored in fixed-size chunks of contiguous slots, so lookups are a shift and a mask away and references
+ * stay valid until the value is erased. Erased slots are recycled, and each recycle bumps the slot's generation so that
+ * handles to the previous occupant are detected as stale instead of silently aliasing the new one.
+ *
+ * A handle packs the slot's generation in its upper 32 bits and the slot's index in its lower 32 bits.
+ * @tparam T value type
+ * @tparam ChunkBits log2 of the number of slots per chunk
+ */
+template <typename T, unsigned ChunkBits = 12>
+class SlotMap
+{
+ public:
+  using Handle = uint64_t;
+  using Index = uint32_t;
+  using Generation = uint32_t;
+
+  static constexpr const Index kChunkSize = Index(1) << ChunkBits;
+  static constexpr const Index kChunkMask = kChunkSize - 1;
+  static constexpr const unsigned kGenerationShift = 32;
+
+  static constexpr Handle MakeHandle(Index index, Generation generation)
+  {
+    return (static_cast<Handle>(generation) << kGenerationShift) | index;
+  }
+  static constexpr Index GetIndex(Handle handle) { return static_cast<Index>(handle); }
+  static constexpr Generation GetGeneration(Handle handle)
+  {
+    return static_cast<Generation>(handle >> kGenerationShift);
+  }
+
+  /**
+   * Constructs a value in a free slot.
+   * @param factory callable that takes the new value's handle and returns the value
+   * @return reference to the stored value
+   */
+  template <typename Factory>
+  T& Emplace(Factory&& factory)
+  {
+    const Index index = Allocate();
+    Slot& slot = GetSlot(index);
+    try
+    {
+      slot.value.emplace(factory(MakeHandle(index, slot.generation)));
+    }
+    catch (...)
+    {
+      // The slot was never occupied, so it can be reused as is.
+      free_list_.push_back(index);
+      throw;
+    }
+    ++size_;
+    return *slot.value;
+  }
+
+  /**
+   * Reserves free slots whose values are constructed later by EmplaceAt. Reserved slots count towards the size, but
+   * are not found until their values are constructed.
+   * @param count the number of slots to reserve
+   * @return handles of the reserved slots
+   */
+  std::vector<Handle> Reserve(std::size_t count)
+  {
+    std::vector<Handle> handles;
+    handles.reserve(count);
+    while (handles.size() < count)
+    {
+      const Index index = Allocate();
+      handles.push_back(MakeHandle(index, GetSlot(index).generation));
+    }
+    size_ += count;
+    return handles;
+  }
+
+  /**
+   * Constructs a value in a slot returned by Reserve. It only modifies that slot, so distinct reserved slots can be
+   * constructed concurrently, as long as nothing else modifies the map meanwhile.
+   * @param handle the handle of the reserved slot
+   * @param factory callable that takes the handle and returns the value
+   * @return reference to the stored value
+   */
+  template <typename Factory>
+  T& EmplaceAt(Handle handle, Factory&& factory)
+  {
+    Slot& slot = GetSlot(GetIndex(handle));
+    slot.value.emplace(factory(handle));
+    return *slot.value;
+  }
+
+  /**
+   * Recycles a slot returned by Reserve, destroying its value if it has been constructed.
+   * @param handle the handle of the reserved slot
+   */
+  void Unreserve(Handle handle)
+  {
+    GetSlot(GetIndex(handle)).value.reset();
+    --size_;
+    Recycle(GetIndex(handle));
+  }
+
+  /**
+   * Returns a pointer to the value with the given handle.
+   * @param handle the handle to find
+   * @return valid pointer if found, nullptr if not found or if the handle is stale
+   */
+  T* Find(Handle handle)
+  {
+    Slot* slot = GetLiveSlot(handle);
+    return slot != nullptr ? &*slot->value : nullptr;
+  }
+
+  const T* Find(Handle handle) const
+  {
+    const Slot* slot = const_cast<SlotMap*>(this)->GetLiveSlot(handle);
+    return slot != nullptr ? &*slot->value : nullptr;
+  }
+
+  /**
+   * Destroys the value with the given handle and recycles its slot.
+   * @param handle the handle to erase
+   * @return true if erased, false if not found or if the handle is stale
+   */
+  bool Erase(Handle handle)
+  {
+    Slot* slot = GetLiveSlot(handle);
+    if (slot == nullptr) return false;
+
+    slot->value.reset();
+    --size_;
+    Recycle(GetIndex(handle));
+    return true;
+  }
+
+  [[nodiscard]] std::size_t Size() const noexcept { return size_; }
+
+  [[nodiscard]] bool Empty() const noexcept { return size_ == 0; }
+
+ private:
+  struct Slot
+  {
+    Generation generation = 0;
+    std::optional<T> value;
+  };
+
+  Slot& GetSlot(Index index) { return chunks_[index >> ChunkBits][index & kChunkMask]; }
+
+  /**
+   * Returns the index of a free slot, which is taken off the free list or appended.
+   */
+  Index Allocate()
+  {
+    if (!free_list_.empty())
+    {
+      const Index index = free_list_.back();
+      free_list_.pop_back();
+      return index;
+    }
+
+    const Index index = num_slots_++;
+    if ((index & kChunkMask) == 0) chunks_.emplace_back(std::make_unique<Slot[]>(kChunkSize));
+    return index;
+  }
+
+  /**
+   * Bumps the generation of an emptied slot and frees it.
+   */
+  void Recycle(Index index)
+  {
+    // A slot whose generation would wrap is retired rather than recycled, so old handles can never match it again.
+    if (++GetSlot(index).generation != 0) free_list_.push_back(index);
+  }
+
+  Slot* GetLiveSlot(Handle handle)
+  {
+    const Index index = GetIndex(handle);
+    if (index >= num_slots_) return nullptr;
+
+    Slot& slot = GetSlot(index);
+    return slot.generation == GetGeneration(handle) && slot.value.has_value() ? &slot : nullptr;
+  }
+
+  std::vector<std::unique_ptr<Slot[]>> chunks_;
+  std::vector<Index> free_list_;
+  Index num_slots_ = 0;
+  std::size_t size_ = 0;
+};
+}  // namespace inv::detail
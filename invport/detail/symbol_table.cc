@@ -0,0 +1,24 @@
+/**
+ * @file symbol_table.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/symbol_table.h"
+
+namespace inv
+{
+SymbolTable::SymbolID SymbolTable::Intern(const Symbol& symbol)
+{
+  const auto id = ids_.Intern(symbol.Get());
+  if (id == symbols_.size()) symbols_.push_back(symbol);
+  return id;
+}
+
+SymbolTable::SymbolID SymbolTable::Intern(std::string_view symbol)
+{
+  const auto id = ids_.Intern(symbol);
+  if (id == symbols_.size()) symbols_.emplace_back(std::string(symbol));
+  return id;
+}
+}  // namespace inv
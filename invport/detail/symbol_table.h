@@ -0,0 +1,105 @@
+/**
+ * @file symbol_table.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <string>
+
+#include "invport/detail/common.h"
+#include "invport/detail/dictionary.h"
+
+namespace inv
+{
+/**
+ * Static class that maps symbols to compact integer IDs for the lifetime of the process.
+ *
+ * Aggregations over transactions can index flat arrays by SymbolID instead of hashing symbol strings. The empty symbol
+ * always has ID kEmptySymbolID.
+ */
+class SymbolTable
+{
+ public:
+  using SymbolID = detail::Dictionary::ID;
+
+  static constexpr const SymbolID kEmptySymbolID = 0;
+
+  SymbolTable() = delete;
+  SymbolTable(const SymbolTable&) = delete;
+
+  /**
+   * Returns the ID of the given symbol, interning it if it is new.
+   */
+  static SymbolID Intern(const Symbol& symbol);
+
+  /**
+   * Returns the ID of the given symbol string, interning it if it is new. A Symbol is only constructed if it is new.
+   */
+  static SymbolID Intern(std::string_view symbol);
+
+  /**
+   * Returns the ID of the given symbol if it has been interned.
+   */
+  static std::optional<SymbolID> Find(const Symbol& symbol) { return ids_.Find(symbol.Get()); }
+
+  /**
+   * Returns the symbol with the given ID.
+   */
+  static const Symbol& Get(SymbolID id) { return symbols_[id]; }
+
+  /**
+   * Returns the number of interned symbols. IDs are in [0, Size()).
+   */
+  static std::size_t Size() noexcept { return symbols_.size(); }
+
+ private:
+  inline static detail::Dictionary ids_{""};
+  inline static std::deque<Symbol> symbols_{Symbol("")};
+};
+
+/**
+ * A Symbol stored as its SymbolTable ID.
+ *
+ * Comparing and hashing an InternedSymbol never touches the symbol's string. The string is only looked up at the edges,
+ * such as serialization or display.
+ */
+class InternedSymbol
+{
+ public:
+  using SymbolID = SymbolTable::SymbolID;
+
+  constexpr InternedSymbol() noexcept = default;
+
+  InternedSymbol(const Symbol& symbol) : id_(SymbolTable::Intern(symbol)) {}  // NOLINT
+
+  explicit InternedSymbol(const json::Json& json) : InternedSymbol(Symbol(json)) {}
+
+  /**
+   * Returns the InternedSymbol with the given ID, which must have been returned by SymbolTable::Intern.
+   */
+  static InternedSymbol FromId(SymbolID id) noexcept
+  {
+    InternedSymbol symbol;
+    symbol.id_ = id;
+    return symbol;
+  }
+
+  [[nodiscard]] SymbolID Id() const noexcept { return id_; }
+
+  [[nodiscard]] const Symbol& ToSymbol() const { return SymbolTable::Get(id_); }
+
+  [[nodiscard]] const std::string& Get() const { return ToSymbol().Get(); }
+
+  operator const Symbol&() const { return ToSymbol(); }  // NOLINT
+
+  bool operator==(const InternedSymbol& other) const noexcept { return id_ == other.id_; }
+  bool operator!=(const InternedSymbol& other) const noexcept { return !(*this == other); }
+
+ private:
+  SymbolID id_ = SymbolTable::kEmptySymbolID;
+};
+}  // namespace inv
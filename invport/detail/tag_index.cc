@@ -0,0 +1,50 @@
+/**
+ * @file tag_index.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/tag_index.h"
+
+namespace inv::detail
+{
+void TagIndex::Insert(TransactionID id, const Transaction::Tags& tags)
+{
+  for (const auto& tag : tags)
+  {
+    keys_[tag.key].insert(id);
+    if (tag.HasValue()) pairs_[PairKey(tag.key, tag.value)].insert(id);
+  }
+}
+
+void TagIndex::Erase(TransactionID id, const Transaction::Tags& tags)
+{
+  for (const auto& tag : tags)
+  {
+    EraseFrom(keys_, tag.key, id);
+    if (tag.HasValue()) EraseFrom(pairs_, PairKey(tag.key, tag.value), id);
+  }
+}
+
+const TagIndex::PostingList* TagIndex::Find(TagID key) const
+{
+  const auto iter = keys_.find(key);
+  return iter != keys_.end() ? &iter->second : nullptr;
+}
+
+const TagIndex::PostingList* TagIndex::Find(TagID key, TagID value) const
+{
+  const auto iter = pairs_.find(PairKey(key, value));
+  return iter != pairs_.end() ? &iter->second : nullptr;
+}
+
+template <typename Map, typename Key>
+void TagIndex::EraseFrom(Map& map, const Key& key, TransactionID id)
+{
+  if (const auto iter = map.find(key); iter != map.end())
+  {
+    iter->second.erase(id);
+    if (iter->second.empty()) map.erase(iter);
+  }
+}
+}  // namespace inv::detail
@@ -0,0 +1,65 @@
+/**
+ * @file tag_index.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "invport/detail/transaction.h"
+
+namespace inv::detail
+{
+/**
+ * Inverted index from tags to the transactions that carry them.
+ *
+ * Each tag key has a posting list, and so does each key=value pair. Lookups cost O(matches) rather than a scan over
+ * every transaction.
+ */
+class TagIndex
+{
+ public:
+  using TransactionID = Transaction::ID;
+  using TagID = Transaction::Tags::TagID;
+  using PostingList = std::unordered_set<TransactionID>;
+
+  /**
+   * Adds the given transaction's tags to the index.
+   */
+  void Insert(TransactionID id, const Transaction::Tags& tags);
+
+  /**
+   * Removes the given transaction's tags from the index.
+   */
+  void Erase(TransactionID id, const Transaction::Tags& tags);
+
+  /**
+   * Returns the transactions tagged with the given key, regardless of value.
+   * @return posting list, or nullptr if no transaction has the key
+   */
+  [[nodiscard]] const PostingList* Find(TagID key) const;
+
+  /**
+   * Returns the transactions tagged with the given key and value.
+   * @return posting list, or nullptr if no transaction has the pair
+   */
+  [[nodiscard]] const PostingList* Find(TagID key, TagID value) const;
+
+  /**
+   * Returns the posting lists of all keys.
+   */
+  [[nodiscard]] const std::unordered_map<TagID, PostingList>& Keys() const noexcept { return keys_; }
+
+ private:
+  static uint64_t PairKey(TagID key, TagID value) { return (static_cast<uint64_t>(key) << 32U) | value; }
+
+  template <typename Map, typename Key>
+  static void EraseFrom(Map& map, const Key& key, TransactionID id);
+
+  std::unordered_map<TagID, PostingList> keys_;
+  std::unordered_map<uint64_t, PostingList> pairs_;
+};
+}  // namespace inv::detail
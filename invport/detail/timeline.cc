@@ -0,0 +1,117 @@
+/**
+ * @file timeline.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/timeline.h"
+
+namespace inv::detail
+{
+void Timeline::const_iterator::Seek(std::size_t pos)
+{
+  pos_ = pos;
+  next_ = pos;
+
+  const auto& dates = timeline_->dates_;
+  if (pos >= dates.size())
+  {
+    value_ = value_type();
+    return;
+  }
+
+  const auto date = dates[pos];
+  while (next_ < dates.size() && dates[next_] == date) ++next_;
+
+  const auto* ids = timeline_->ids_.data();
+  value_ = {Date(date), Bucket(ids + pos, ids + next_)};
+}
+
+std::size_t Timeline::LowerBound(const Date& date) const
+{
+  return std::lower_bound(dates_.begin(), dates_.end(), date.ToPrimitive()) - dates_.begin();
+}
+
+std::size_t Timeline::UpperBound(const Date& date) const
+{
+  // Most insertions are for the latest date, so check the back before searching.
+  const auto pt = date.ToPrimitive();
+  if (dates_.empty() || dates_.back() <= pt) return dates_.size();
+  return std::upper_bound(dates_.begin(), dates_.end(), pt) - dates_.begin();
+}
+
+Timeline::const_iterator Timeline::find(const Date& date) const
+{
+  const auto pos = LowerBound(date);
+  return pos < dates_.size() && dates_[pos] == date.ToPrimitive() ? const_iterator(this, pos) : end();
+}
+
+Timeline::Bucket Timeline::at(const Date& date) const
+{
+  const auto lo = LowerBound(date);
+  const auto hi = UpperBound(date);
+  return {ids_.data() + lo, ids_.data() + hi};
+}
+
+bool Timeline::Insert(const Date& date, TransactionID id)
+{
+  const auto hi = UpperBound(date);
+  const auto lo = std::lower_bound(dates_.begin(), dates_.begin() + hi, date.ToPrimitive()) - dates_.begin();
+  if (std::find(ids_.begin() + lo, ids_.begin() + hi, id) != ids_.begin() + hi) return false;
+
+  dates_.insert(dates_.begin() + hi, date.ToPrimitive());
+  ids_.insert(ids_.begin() + hi, id);
+  return true;
+}
+
+void Timeline::Insert(const std::vector<std::pair<Date::PrimitiveType, TransactionID>>& entries)
+{
+  std::vector<Date::PrimitiveType> dates;
+  std::vector<TransactionID> ids;
+  dates.reserve(dates_.size() + entries.size());
+  ids.reserve(ids_.size() + entries.size());
+
+  std::size_t i = 0;
+  for (const auto& [date, id] : entries)
+  {
+    // Existing IDs of a date stay ahead of new ones.
+    for (; i < dates_.size() && dates_[i] <= date; ++i)
+    {
+      dates.push_back(dates_[i]);
+      ids.push_back(ids_[i]);
+    }
+
+    // Only existing IDs need to be checked, as the entries themselves are distinct.
+    const auto bucket_begin = std::lower_bound(dates_.begin(), dates_.begin() + i, date) - dates_.begin();
+    if (std::find(ids_.begin() + bucket_begin, ids_.begin() + i, id) != ids_.begin() + i) continue;
+
+    dates.push_back(date);
+    ids.push_back(id);
+  }
+  dates.insert(dates.end(), dates_.begin() + i, dates_.end());
+  ids.insert(ids.end(), ids_.begin() + i, ids_.end());
+
+  dates_ = std::move(dates);
+  ids_ = std::move(ids);
+}
+
+std::pair<Timeline::const_iterator, bool> Timeline::Erase(const Date& date, TransactionID id)
+{
+  const auto lo = LowerBound(date);
+  const auto hi = UpperBound(date);
+
+  const auto iter = std::find(ids_.begin() + lo, ids_.begin() + hi, id);
+  if (iter == ids_.begin() + hi) return {end(), false};
+
+  const auto pos = iter - ids_.begin();
+  dates_.erase(dates_.begin() + pos);
+  ids_.erase(iter);
+  return {const_iterator(this, lo), hi - lo == 1};
+}
+
+bool operator==(const Timeline& lhs, const Timeline& rhs)
+{
+  if (lhs.dates_ != rhs.dates_) return false;
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+}  // namespace inv::detail
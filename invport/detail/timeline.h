@@ -0,0 +1,173 @@
+/**
+ * @file timeline.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "invport/detail/transaction.h"
+#include "invport/detail/utils.h"
+
+namespace inv::detail
+{
+/**
+ * A date-ordered multimap of transaction IDs stored in two parallel, sorted arrays.
+ *
+ * Iterating yields one (Date, Bucket) pair per distinct date, where the Bucket is a view over that date's IDs. The IDs
+ * of a date are contiguous, in insertion order, so an in-order scan streams through memory instead of visiting one node
+ * and one hash set per date.
+ *
+ * Like std::vector, inserting or erasing invalidates iterators and buckets.
+ */
+class Timeline
+{
+ public:
+  using TransactionID = Transaction::ID;
+
+  /**
+   * A read-only view over the IDs of a single date.
+   */
+  class Bucket
+  {
+   public:
+    using const_iterator = const TransactionID*;
+
+    Bucket() noexcept : first_(nullptr), last_(nullptr) {}
+    Bucket(const TransactionID* first, const TransactionID* last) : first_(first), last_(last) {}
+
+    [[nodiscard]] const_iterator begin() const noexcept { return first_; }
+    [[nodiscard]] const_iterator end() const noexcept { return last_; }
+    [[nodiscard]] std::size_t size() const noexcept { return last_ - first_; }
+    [[nodiscard]] bool empty() const noexcept { return first_ == last_; }
+    [[nodiscard]] std::size_t count(TransactionID id) const { return std::count(first_, last_, id); }
+
+    // Buckets compare as sets, as the order of IDs within a date is not significant.
+    friend bool operator==(const Bucket& lhs, const Bucket& rhs)
+    {
+      return std::is_permutation(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+    friend bool operator!=(const Bucket& lhs, const Bucket& rhs) { return !(lhs == rhs); }
+
+   private:
+    const TransactionID* first_;
+    const TransactionID* last_;
+  };
+
+  using value_type = std::pair<Date, Bucket>;
+
+  class const_iterator
+  {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Timeline::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return value_; }
+    pointer operator->() const { return &value_; }
+
+    const_iterator& operator++()
+    {
+      Seek(next_);
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const const_iterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class Timeline;
+
+    const_iterator(const Timeline* timeline, std::size_t pos) : timeline_(timeline) { Seek(pos); }
+
+    void Seek(std::size_t pos);
+
+    const Timeline* timeline_ = nullptr;
+    std::size_t pos_ = 0;
+    std::size_t next_ = 0;
+    value_type value_;
+  };
+
+  using iterator = const_iterator;
+
+  [[nodiscard]] const_iterator begin() const { return {this, 0}; }
+  [[nodiscard]] const_iterator end() const { return {this, dates_.size()}; }
+
+  /**
+   * Returns an iterator to the given date's bucket, or end() if the date has no IDs.
+   */
+  [[nodiscard]] const_iterator find(const Date& date) const;
+
+  /**
+   * Returns an iterator to the first date not before the given date.
+   */
+  [[nodiscard]] const_iterator lower_bound(const Date& date) const { return {this, LowerBound(date)}; }
+
+  /**
+   * Returns an iterator to the first date after the given date.
+   */
+  [[nodiscard]] const_iterator upper_bound(const Date& date) const { return {this, UpperBound(date)}; }
+
+  /**
+   * Returns the given date's bucket, which is empty if the date has no IDs.
+   */
+  [[nodiscard]] Bucket at(const Date& date) const;
+
+  [[nodiscard]] bool empty() const noexcept { return dates_.empty(); }
+
+  /**
+   * Returns the number of IDs, not the number of dates.
+   */
+  [[nodiscard]] std::size_t size() const noexcept { return ids_.size(); }
+
+  void reserve(std::size_t n)
+  {
+    dates_.reserve(n);
+    ids_.reserve(n);
+  }
+
+  /**
+   * Adds an ID at the end of the given date's bucket. Appending to the latest date is amortized O(1).
+   * @return true if inserted, false if the ID was already in the bucket
+   */
+  bool Insert(const Date& date, TransactionID id);
+
+  /**
+   * Inserts many entries at once in a single linear merge.
+   * @param entries (date, id) pairs sorted by date, with distinct IDs; IDs already present on their date are skipped
+   */
+  void Insert(const std::vector<std::pair<Date::PrimitiveType, TransactionID>>& entries);
+
+  /**
+   * Removes an ID from the given date's bucket.
+   * @return iterator to the date's bucket, or to the next date if the bucket became empty, and whether it did
+   */
+  std::pair<const_iterator, bool> Erase(const Date& date, TransactionID id);
+
+  friend bool operator==(const Timeline& lhs, const Timeline& rhs);
+  friend bool operator!=(const Timeline& lhs, const Timeline& rhs) { return !(lhs == rhs); }
+
+ private:
+  [[nodiscard]] std::size_t LowerBound(const Date& date) const;
+  [[nodiscard]] std::size_t UpperBound(const Date& date) const;
+
+  std::vector<Date::PrimitiveType> dates_;
+  std::vector<TransactionID> ids_;
+};
+}  // namespace inv::detail
@@ -0,0 +1,239 @@
+/**
+ * @file totals_index.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/totals_index.h"
+
+#include <algorithm>
+
+namespace inv::detail
+{
+namespace
+{
+inline std::size_t LowBit(std::size_t i) { return i & (~i + 1); }
+}  // namespace
+
+void TotalsIndex::Series::Build() const
+{
+  const auto n = buckets.size();
+  tree.assign(n + 1, Totals());
+  for (std::size_t i = 1; i <= n; ++i)
+  {
+    tree[i] += buckets[i - 1];
+    if (const auto parent = i + LowBit(i); parent <= n) tree[parent] += tree[i];
+  }
+  dirty = false;
+}
+
+void TotalsIndex::Series::Add(std::size_t pos, const Totals& totals)
+{
+  for (auto i = pos + 1; i < tree.size(); i += LowBit(i)) tree[i] += totals;
+}
+
+TotalsIndex::Totals TotalsIndex::Series::Prefix(std::size_t count) const
+{
+  Totals totals;
+  for (auto i = count; i > 0; i -= LowBit(i)) totals += tree[i];
+  return totals;
+}
+
+TotalsIndex::Totals TotalsIndex::Series::Cumulative(std::size_t count) const
+{
+  const auto k = count / kCheckpointInterval;
+  if (checkpoints.empty()) checkpoints.emplace_back();
+  while (checkpoints.size() <= k)
+  {
+    Totals totals = checkpoints.back();
+    const auto begin = (checkpoints.size() - 1) * kCheckpointInterval;
+    for (auto i = begin; i < begin + kCheckpointInterval; ++i) totals += buckets[i];
+    checkpoints.push_back(totals);
+  }
+
+  Totals totals = checkpoints[k];
+  for (auto i = k * kCheckpointInterval; i < count; ++i) totals += buckets[i];
+  return totals;
+}
+
+std::size_t TotalsIndex::Series::CountUntil(const Date& date) const
+{
+  if (date.IsZero()) return dates.size();
+  return std::upper_bound(dates.begin(), dates.end(), date.ToPrimitive()) - dates.begin();
+}
+
+void TotalsIndex::Series::Invalidate(std::size_t pos)
+{
+  checkpoints.resize(std::min(checkpoints.size(), pos / kCheckpointInterval + 1));
+}
+
+void TotalsIndex::Series::Merge(const Transaction* const* first, const Transaction* const* last)
+{
+  std::vector<Date::PrimitiveType> merged_dates;
+  std::vector<Totals> merged_buckets;
+  std::vector<uint32_t> merged_counts;
+  merged_dates.reserve(dates.size() + (last - first));
+  merged_buckets.reserve(dates.size() + (last - first));
+  merged_counts.reserve(dates.size() + (last - first));
+
+  Invalidate(std::lower_bound(dates.begin(), dates.end(), (*first)->date.ToPrimitive()) - dates.begin());
+
+  std::size_t i = 0;
+  while (first != last)
+  {
+    const auto date = (*first)->date.ToPrimitive();
+    for (; i < dates.size() && dates[i] < date; ++i)
+    {
+      merged_dates.push_back(dates[i]);
+      merged_buckets.push_back(buckets[i]);
+      merged_counts.push_back(counts[i]);
+    }
+
+    Totals totals;
+    uint32_t count = 0;
+    if (i < dates.size() && dates[i] == date)
+    {
+      totals = buckets[i];
+      count = counts[i++];
+    }
+    for (; first != last && (*first)->date.ToPrimitive() == date; ++first)
+    {
+      totals += Totals(**first);
+      ++count;
+    }
+    merged_dates.push_back(date);
+    merged_buckets.push_back(totals);
+    merged_counts.push_back(count);
+  }
+  merged_dates.insert(merged_dates.end(), dates.begin() + i, dates.end());
+  merged_buckets.insert(merged_buckets.end(), buckets.begin() + i, buckets.end());
+  merged_counts.insert(merged_counts.end(), counts.begin() + i, counts.end());
+
+  dates = std::move(merged_dates);
+  buckets = std::move(merged_buckets);
+  counts = std::move(merged_counts);
+  dirty = true;
+}
+
+TotalsIndex::Series& TotalsIndex::GetSeries(SymbolID id)
+{
+  if (id >= series_.size()) series_.resize(SymbolTable::Size());
+  return series_[id];
+}
+
+void TotalsIndex::Insert(const Transaction& tr)
+{
+  auto& series = GetSeries(tr.symbol.Id());
+  const Totals totals(tr);
+  const auto date = tr.date.ToPrimitive();
+
+  const auto iter = std::lower_bound(series.dates.begin(), series.dates.end(), date);
+  const auto pos = static_cast<std::size_t>(iter - series.dates.begin());
+  series.Invalidate(pos);
+  if (iter != series.dates.end() && *iter == date)
+  {
+    series.buckets[pos] += totals;
+    ++series.counts[pos];
+    if (!series.dirty) series.Add(pos, totals);
+  }
+  else
+  {
+    series.dates.insert(iter, date);
+    series.buckets.insert(series.buckets.begin() + pos, totals);
+    series.counts.insert(series.counts.begin() + pos, 1);
+    series.dirty = true;
+  }
+}
+
+void TotalsIndex::Insert(std::vector<const Transaction*> trs)
+{
+  std::sort(trs.begin(), trs.end(), [](const Transaction* lhs, const Transaction* rhs) {
+    if (lhs->symbol.Id() != rhs->symbol.Id()) return lhs->symbol.Id() < rhs->symbol.Id();
+    return lhs->date < rhs->date;
+  });
+
+  // Merge each symbol's run of transactions into its series.
+  const auto* first = trs.data();
+  const auto* const end = trs.data() + trs.size();
+  while (first != end)
+  {
+    const auto id = (*first)->symbol.Id();
+    const auto* last = std::find_if(first, end, [id](const Transaction* tr) { return tr->symbol.Id() != id; });
+    GetSeries(id).Merge(first, last);
+    first = last;
+  }
+}
+
+void TotalsIndex::Erase(const Transaction& tr)
+{
+  auto& series = GetSeries(tr.symbol.Id());
+  const Totals totals(tr);
+  const auto date = tr.date.ToPrimitive();
+
+  const auto iter = std::lower_bound(series.dates.begin(), series.dates.end(), date);
+  if (iter == series.dates.end() || *iter != date) return;
+
+  const auto pos = static_cast<std::size_t>(iter - series.dates.begin());
+  series.Invalidate(pos);
+  if (--series.counts[pos] == 0)
+  {
+    series.dates.erase(iter);
+    series.buckets.erase(series.buckets.begin() + pos);
+    series.counts.erase(series.counts.begin() + pos);
+    series.dirty = true;
+  }
+  else
+  {
+    series.buckets[pos] -= totals;
+    if (!series.dirty) series.Add(pos, -totals);
+  }
+}
+
+iex::SymbolMap<TotalsIndex::Totals> TotalsIndex::Query(const Date& start_date, const Date& end_date) const
+{
+  if (start_date.IsZero()) return QueryAsOf(end_date);
+
+  iex::SymbolMap<Totals> map;
+  for (std::size_t id = 0; id < series_.size(); ++id)
+  {
+    const auto& series = series_[id];
+    if (series.dates.empty()) continue;
+
+    const auto begin = !start_date.IsZero()
+                           ? std::lower_bound(series.dates.begin(), series.dates.end(), start_date.ToPrimitive())
+                           : series.dates.begin();
+    const auto end =
+        !end_date.IsZero() ? std::upper_bound(begin, series.dates.end(), end_date.ToPrimitive()) : series.dates.end();
+    if (begin == end) continue;
+
+    if (series.dirty) series.Build();
+
+    const auto lo = static_cast<std::size_t>(begin - series.dates.begin());
+    const auto hi = static_cast<std::size_t>(end - series.dates.begin());
+    Totals totals = series.Prefix(hi);
+    if (lo > 0) totals -= series.Prefix(lo);
+    map.emplace(SymbolTable::Get(static_cast<SymbolID>(id)), totals);
+  }
+  return map;
+}
+
+iex::SymbolMap<TotalsIndex::Totals> TotalsIndex::QueryAsOf(const Date& date) const
+{
+  iex::SymbolMap<Totals> map;
+  for (std::size_t id = 0; id < series_.size(); ++id)
+  {
+    const auto& series = series_[id];
+    const auto count = series.CountUntil(date);
+    if (count > 0) map.emplace(SymbolTable::Get(static_cast<SymbolID>(id)), series.Cumulative(count));
+  }
+  return map;
+}
+
+TotalsIndex::Totals TotalsIndex::QueryAsOf(SymbolID id, const Date& date) const
+{
+  if (id >= series_.size()) return {};
+
+  const auto& series = series_[id];
+  return series.Cumulative(series.CountUntil(date));
+}
+}  // namespace inv::detail
@@ -0,0 +1,102 @@
+/**
+ * @file totals_index.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "invport/detail/symbol_table.h"
+#include "invport/detail/transaction.h"
+#include "invport/detail/utils.h"
+
+namespace inv::detail
+{
+/**
+ * Per-symbol range-aggregate index of Transaction::Totals keyed on Date.
+ *
+ * For each symbol, totals are bucketed by date and a Fenwick tree over the buckets answers prefix sums. Totals between
+ * any two dates are then the difference of two prefix sums, in O(log n) per symbol instead of a walk over every
+ * transaction in the window.
+ *
+ * Adding to an existing date updates the tree in O(log n). Adding or removing a date shifts the symbol's arrays in O(n)
+ * and invalidates its tree, which is rebuilt in O(n) on the next query. Adding many dates one at a time, out of order,
+ * is therefore quadratic; bulk loads and merges use the batch Insert, which merges them in a single pass.
+ *
+ * Point-in-time queries use a second structure: a cumulative checkpoint every kCheckpointInterval dates, built lazily.
+ * An as-of lookup is a binary search, a checkpoint, and a replay of at most kCheckpointInterval buckets. A change to a
+ * date only discards the checkpoints after it.
+ */
+class TotalsIndex
+{
+ public:
+  using Totals = Transaction::Totals;
+  using SymbolID = SymbolTable::SymbolID;
+
+  static constexpr const std::size_t kCheckpointInterval = 64;
+
+  void Insert(const Transaction& tr);
+
+  /**
+   * Inserts many transactions at once, in any order. Each symbol's new dates are merged into its series in one pass,
+   * and its tree is rebuilt once, on the next query.
+   * @param trs the transactions to insert
+   */
+  void Insert(std::vector<const Transaction*> trs);
+
+  void Erase(const Transaction& tr);
+
+  /**
+   * Gets the totals per symbol between the given dates.
+   * @param start_date the starting date, inclusive, or zero, which will evaluate from the first date
+   * @param end_date the stopping date, inclusive, or zero, which will evaluate until the last date
+   * @return symbol map of Totals, containing only symbols with transactions between the dates
+   */
+  [[nodiscard]] iex::SymbolMap<Totals> Query(const Date& start_date, const Date& end_date) const;
+
+  /**
+   * Gets the totals per symbol of all transactions up to and including the given date.
+   * @param date the date to evaluate, or zero for all transactions
+   * @return symbol map of Totals, containing only symbols with transactions up to the date
+   */
+  [[nodiscard]] iex::SymbolMap<Totals> QueryAsOf(const Date& date) const;
+
+  /**
+   * Gets the totals of one symbol's transactions up to and including the given date.
+   * @param id the symbol
+   * @param date the date to evaluate, or zero for all transactions
+   * @return Totals, which are zero if the symbol has no transactions up to the date
+   */
+  [[nodiscard]] Totals QueryAsOf(SymbolID id, const Date& date) const;
+
+ private:
+  struct Series
+  {
+    void Build() const;
+    void Add(std::size_t pos, const Totals& totals);
+    [[nodiscard]] Totals Prefix(std::size_t count) const;
+    [[nodiscard]] Totals Cumulative(std::size_t count) const;
+    [[nodiscard]] std::size_t CountUntil(const Date& date) const;
+    void Invalidate(std::size_t pos);
+    void Merge(const Transaction* const* first, const Transaction* const* last);
+
+    std::vector<Date::PrimitiveType> dates;
+    std::vector<Totals> buckets;
+    std::vector<uint32_t> counts;
+
+    mutable std::vector<Totals> tree;
+    mutable bool dirty = false;
+
+    /**
+     * checkpoints[k] is the sum of the first k * kCheckpointInterval buckets.
+     */
+    mutable std::vector<Totals> checkpoints;
+  };
+
+  Series& GetSeries(SymbolID id);
+
+  std::vector<Series> series_;
+};
+}  // namespace inv::detail
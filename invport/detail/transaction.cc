@@ -6,6 +6,8 @@
 
 #include "invport/detail/transaction.h"
 
+#include <algorithm>
+
 namespace inv::detail
 {
 namespace
@@ -25,20 +27,36 @@ constexpr const char* const kSellStr = "Sell";
 std::string TypeToString(const Transaction::Type t) { return t == Transaction::Type::BUY ? kBuyStr : kSellStr; }
 }  // namespace
 
+Transaction::Tags::Tags() noexcept = default;
+
 Transaction::Tags::Tags(std::initializer_list<Tag> tags)
 {
-  for (const auto& tag : tags) Add(std::move(tag));
+  for (const auto& tag : tags) Add(tag);
+}
+
+Transaction::Tags::Tags(const Tags& other) { *this = other; }
+
+Transaction::Tags& Transaction::Tags::operator=(const Tags& other)
+{
+  if (this != &other)
+  {
+    inline_ = other.inline_;
+    size_ = other.size_;
+    overflow_ = other.overflow_ ? std::make_unique<std::vector<Entry>>(*other.overflow_) : nullptr;
+  }
+  return *this;
 }
 
 Transaction::Tags& Transaction::Tags::operator=(const json::Json& json)
 {
   for (const auto& jstr : json)
   {
-    auto vec = Split(jstr.get<std::string>());
-    if (vec.size() == 2)
-      Add(std::move(vec[0]), std::move(vec[1]));
-    else if (vec.size() == 1)
-      Add(std::move(vec[0]));
+    const auto& str = jstr.get_ref<const std::string&>();
+    const auto delimiter = str.find('=');
+    if (delimiter != std::string::npos)
+      Add(std::string_view(str).substr(0, delimiter), std::string_view(str).substr(delimiter + 1));
+    else
+      Add(str);
   }
   return *this;
 }
@@ -46,8 +64,8 @@ Transaction::Tags& Transaction::Tags::operator=(const json::Json& json)
 Transaction::Tags::operator std::unordered_set<std::string>() const noexcept
 {
   std::unordered_set<std::string> ts;
-  ts.reserve(size());
-  for (const auto& [key, value] : *this) ts.insert(value.has_value() ? key + "=" + value.value() : key);
+  ts.reserve(size_);
+  for (const auto& tag : *this) ts.insert(tag.HasValue() ? tag.Key() + "=" + tag.Value() : tag.Key());
   return ts;
 }
 
@@ -56,10 +74,37 @@ Transaction::Tags::operator json::Json() const noexcept { return operator std::u
 std::unordered_set<Transaction::Tag> Transaction::Tags::Keys() const
 {
   std::unordered_set<Tag> set;
-  for (const auto& [key, value] : *this) set.insert(key);
+  for (const auto& tag : *this) set.insert(tag.Key());
   return set;
 }
 
+void Transaction::Tags::Add(TagID key, TagID value)
+{
+  if (Contains(key)) return;
+
+  if (size_ < kInlineCapacity)
+  {
+    inline_[size_] = {key, value};
+  }
+  else
+  {
+    if (!overflow_) overflow_ = std::make_unique<std::vector<Entry>>(inline_.begin(), inline_.end());
+    overflow_->push_back({key, value});
+  }
+  ++size_;
+}
+
+bool Transaction::Tags::Contains(const Tag& key) const
+{
+  const auto id = Find(key);
+  return id.has_value() && Contains(*id);
+}
+
+bool Transaction::Tags::Contains(TagID key) const
+{
+  return std::any_of(begin(), end(), [key](const Entry& tag) { return tag.key == key; });
+}
+
 Transaction Transaction::Factory(const ID id, const json::Json& input_json)
 {
   Transaction tr(id);
@@ -69,12 +114,21 @@ Transaction Transaction::Factory(const ID id, const json::Json& input_json)
   return tr;
 }
 
-Transaction Transaction::Factory(Transaction::ID id, Date d, Symbol s, Transaction::Type t, Price p,
+Transaction Transaction::Factory(const ID id, JsonReader& reader)
+{
+  Transaction tr(id);
+  auto ec = tr.Deserialize(reader);
+  if (ec.Failure()) throw std::runtime_error(ErrorCode("Transaction::Factory() failed", std::move(ec)));
+
+  return tr;
+}
+
+Transaction Transaction::Factory(Transaction::ID id, Date d, InternedSymbol s, Transaction::Type t, Price p,
                                  Transaction::Quantity q, Price f, Transaction::Tags tags, Transaction::Comment c)
 {
   Transaction tr(id);
   tr.date = d;
-  tr.symbol = std::move(s);
+  tr.symbol = s;
   tr.type = t;
   tr.price = p;
   tr.quantity = q;
@@ -121,6 +175,46 @@ void Transaction::ToTreeRow(Gtk::TreeRow& row) const
   return {json, {}};
 }
 
+ErrorCode Transaction::Serialize(JsonWriter& writer) const
+{
+  std::vector<TagView> tag_views;
+  tag_views.reserve(tags.Size());
+  for (const auto& tag : tags)
+    tag_views.emplace_back(tag.Key(), tag.HasValue() ? std::optional<std::string_view>(tag.Value()) : std::nullopt);
+
+  Serialize(writer, date, symbol.Get(), type, price, quantity, fee, tag_views, comment);
+  return {};
+}
+
+void Transaction::Serialize(JsonWriter& writer, const Date d, const std::string_view s, const Type t, const Price p,
+                            const Quantity q, const Price f, const std::vector<TagView>& tags, const std::string_view c)
+{
+  writer.BeginObject();
+  writer.Key(kJsonDateKey).Number(d.ToPrimitive());
+  writer.Key(kJsonSymbolKey).String(s);
+  writer.Key(kJsonTypeKey).Number(static_cast<int>(t));
+  writer.Key(kJsonPriceKey).Number(p);
+  writer.Key(kJsonQuantityKey).Number(q);
+  writer.Key(kJsonFeeKey).Number(f);
+
+  writer.Key(kJsonTagsKey).BeginArray();
+  std::string tag_str;
+  for (const auto& [key, value] : tags)
+  {
+    if (!value)
+    {
+      writer.String(key);
+      continue;
+    }
+    tag_str.assign(key).append(1, '=').append(*value);
+    writer.String(tag_str);
+  }
+  writer.EndArray();
+
+  writer.Key(kJsonCommentKey).String(c);
+  writer.EndObject();
+}
+
 ErrorCode Transaction::Deserialize(const json::Json& input_json)
 {
   try
@@ -142,12 +236,113 @@ ErrorCode Transaction::Deserialize(const json::Json& input_json)
   return {};
 }
 
+ErrorCode Transaction::Deserialize(JsonReader& reader)
+{
+  // Bits of the members that every transaction must have.
+  constexpr unsigned kHasDate = 1U << 0;
+  constexpr unsigned kHasSymbol = 1U << 1;
+  constexpr unsigned kHasType = 1U << 2;
+  constexpr unsigned kHasPrice = 1U << 3;
+  constexpr unsigned kHasQuantity = 1U << 4;
+  constexpr unsigned kHasFee = 1U << 5;
+  constexpr unsigned kHasRequired = (1U << 6) - 1;
+
+  try
+  {
+    unsigned members = 0;
+    reader.BeginObject();
+    while (reader.HasNext())
+    {
+      const auto key = reader.Key();
+      if (key == kJsonDateKey)
+      {
+        date = Date(reader.Number<Date::PrimitiveType>());
+        members |= kHasDate;
+      }
+      else if (key == kJsonSymbolKey)
+      {
+        symbol = InternedSymbol::FromId(SymbolTable::Intern(reader.String()));
+        members |= kHasSymbol;
+      }
+      else if (key == kJsonTypeKey)
+      {
+        const auto t = reader.Number<int>();
+        if (t != BUY && t != SELL) throw std::runtime_error("invalid transaction type " + std::to_string(t));
+        type = static_cast<Type>(t);
+        members |= kHasType;
+      }
+      else if (key == kJsonPriceKey)
+      {
+        price = reader.Number<Price>();
+        members |= kHasPrice;
+      }
+      else if (key == kJsonQuantityKey)
+      {
+        quantity = reader.Number<Quantity>();
+        members |= kHasQuantity;
+      }
+      else if (key == kJsonFeeKey)
+      {
+        fee = reader.Number<Price>();
+        members |= kHasFee;
+      }
+      else if (key == kJsonTagsKey)
+      {
+        reader.BeginArray();
+        while (reader.HasNext())
+        {
+          const auto str = reader.String();
+          const auto delimiter = str.find('=');
+          if (delimiter != std::string_view::npos)
+            tags.Add(str.substr(0, delimiter), str.substr(delimiter + 1));
+          else
+            tags.Add(str);
+        }
+        reader.EndArray();
+      }
+      else if (key == kJsonCommentKey)
+      {
+        comment = reader.String();
+      }
+      else
+      {
+        reader.Skip();
+      }
+    }
+    reader.EndObject();
+
+    if (members != kHasRequired)
+      throw std::runtime_error("transaction ending at byte " + std::to_string(reader.Offset()) +
+                               " is missing a member");
+  }
+  catch (const std::exception& e)
+  {
+    return ErrorCode("Transaction::Deserialize() failed", ErrorCode(e.what()));
+  }
+
+  return {};
+}
+
 bool Transaction::MemberwiseEquals(const Transaction& other) const
 {
   return date == other.date && symbol == other.symbol && type == other.type && price == other.price &&
          quantity == other.quantity && fee == other.fee;
 }
 
+uint64_t Transaction::Fingerprint() const noexcept
+{
+  const auto mix = [](auto value, uint64_t hash) {
+    return Fnv1a(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)), hash);
+  };
+
+  auto hash = mix(date.ToPrimitive(), Fnv1a({}));
+  hash = mix(symbol.Id(), hash);
+  hash = mix(type, hash);
+  hash = mix(price.ToRaw(), hash);
+  hash = mix(quantity.ToRaw(), hash);
+  return mix(fee.ToRaw(), hash);
+}
+
 bool TransactionMemberwiseComparator::operator()(const Transaction::ID& left, const Transaction::ID& right) const
 {
   return TransactionPool::Find(left)->MemberwiseEquals(*TransactionPool::Find(right));
@@ -155,9 +350,6 @@ bool TransactionMemberwiseComparator::operator()(const Transaction::ID& left, co
 
 std::size_t TransactionMemberwiseHasher::operator()(const Transaction::ID& id) const
 {
-  const auto& tr = *TransactionPool::Find(id);
-  std::vector<std::string> v = {tr.date.ToString(), tr.symbol.Get(),       TypeToString(tr.type),
-                                ToString(tr.price), ToString(tr.quantity), ToString(tr.fee)};
-  return std::hash<std::string>()(Join(v.begin(), v.end(), "."));
+  return TransactionPool::Find(id)->Fingerprint();
 }
 }  // namespace inv::detail
\ No newline at end of file
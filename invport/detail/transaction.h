@@ -8,10 +8,21 @@
 
 #include <gtkmm.h>
 
+#include <array>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "invport/detail/dictionary.h"
+#include "invport/detail/json_reader.h"
+#include "invport/detail/json_writer.h"
+#include "invport/detail/slot_map.h"
+#include "invport/detail/symbol_table.h"
 #include "invport/detail/utils.h"
 
 namespace inv
@@ -27,21 +38,89 @@ namespace detail
 struct Transaction : json::JsonBidirectionalSerializable
 {
   using ID = uint64_t;
-  using Quantity = double;
+  /**
+   * A number of shares, to a millionth of a share.
+   */
+  using Quantity = Decimal<6>;
   using Tag = std::string;
-  struct Tags : std::unordered_map<Tag, std::optional<std::string>>
+
+  /**
+   * User-defined tags, each a key with an optional value.
+   *
+   * Keys and values are interned, so a tag is a pair of integer IDs. The first kInlineCapacity tags are stored inline,
+   * so a typical transaction's tags need no heap allocation. Strings are only produced when converting to a string set
+   * or to JSON.
+   */
+  class Tags
   {
-    Tags() = default;
+   public:
+    using TagID = Dictionary::ID;
+
+    static constexpr const TagID kNoValue = std::numeric_limits<TagID>::max();
+    static constexpr const uint32_t kInlineCapacity = 3;
+
+    struct Entry
+    {
+      TagID key;
+      TagID value;
+
+      [[nodiscard]] bool HasValue() const noexcept { return value != kNoValue; }
+      [[nodiscard]] const std::string& Key() const { return GetString(key); }
+      [[nodiscard]] const std::string& Value() const { return GetString(value); }
+    };
+
+    Tags() noexcept;
     Tags(std::initializer_list<Tag> tags);
+    Tags(const Tags& other);
+    Tags(Tags&& other) noexcept { *this = std::move(other); }
+    Tags& operator=(const Tags& other);
+    Tags& operator=(Tags&& other) noexcept
+    {
+      inline_ = other.inline_;
+      size_ = std::exchange(other.size_, 0);
+      overflow_ = std::move(other.overflow_);
+      return *this;
+    }
     Tags& operator=(const json::Json& json);
 
     operator std::unordered_set<std::string>() const noexcept;  // NOLINT
     operator json::Json() const noexcept;                       // NOLINT
 
-    std::unordered_set<Tag> Keys() const;
+    [[nodiscard]] std::unordered_set<Tag> Keys() const;
+
+    /**
+     * Adds a tag without a value. Does nothing if the key is already present.
+     */
+    void Add(std::string_view key) { Add(Intern(key), kNoValue); }
+
+    /**
+     * Adds a tag with a value. Does nothing if the key is already present.
+     */
+    void Add(std::string_view key, std::string_view value) { Add(Intern(key), Intern(value)); }
+
+    void Add(TagID key, TagID value);
+
+    [[nodiscard]] bool Contains(const Tag& key) const;
+
+    [[nodiscard]] bool Contains(TagID key) const;
 
-    inline void Add(Tag tag) { emplace(std::move(tag), std::nullopt); }
-    inline void Add(Tag tag, std::string value) { emplace(std::move(tag), std::move(value)); }
+    [[nodiscard]] const Entry* begin() const noexcept { return Data(); }
+    [[nodiscard]] const Entry* end() const noexcept { return Data() + size_; }
+    [[nodiscard]] uint32_t Size() const noexcept { return size_; }
+    [[nodiscard]] bool Empty() const noexcept { return size_ == 0; }
+
+    static TagID Intern(std::string_view str) { return dictionary_.Intern(str); }
+    static std::optional<TagID> Find(std::string_view str) { return dictionary_.Find(str); }
+    static const std::string& GetString(TagID id) { return dictionary_.Get(id); }
+
+   private:
+    [[nodiscard]] const Entry* Data() const noexcept { return overflow_ ? overflow_->data() : inline_.data(); }
+
+    std::array<Entry, kInlineCapacity> inline_{};
+    uint32_t size_ = 0;
+    std::unique_ptr<std::vector<Entry>> overflow_;
+
+    inline static Dictionary dictionary_;
   };
   using Comment = std::string;
 
@@ -65,6 +144,10 @@ struct Transaction : json::JsonBidirectionalSerializable
     NUM_FIELDS
   };
 
+  /**
+   * The sums of a symbol's transactions. Sums of decimals are exact, so they do not depend on the order of the
+   * transactions.
+   */
   struct Totals
   {
     Totals() = default;
@@ -83,9 +166,24 @@ struct Transaction : json::JsonBidirectionalSerializable
       return *this;
     }
 
-    Price spent;
-    Transaction::Quantity quantity;
-    Price fees;
+    inline Totals& operator-=(const Totals& other)
+    {
+      spent -= other.spent;
+      quantity -= other.quantity;
+      fees -= other.fees;
+      return *this;
+    }
+
+    inline Totals operator-() const
+    {
+      Totals totals;
+      totals -= *this;
+      return totals;
+    }
+
+    Price spent = 0;
+    Transaction::Quantity quantity = 0;
+    Price fees = 0;
   };
 
   /**
@@ -101,26 +199,63 @@ struct Transaction : json::JsonBidirectionalSerializable
    */
   static Transaction Factory(ID id, const json::Json& input_json);
 
+  /**
+   * Transaction factory method to deserialize the next JSON object of a reader.
+   * @param id unique ID
+   * @param reader reader positioned before a transaction object
+   * @return new Transaction
+   */
+  static Transaction Factory(ID id, JsonReader& reader);
+
   /**
    * Transaction factory method to populate members manually.
    * @param id unique ID
    * @return new Transaction
    */
-  static Transaction Factory(ID id, Date d, Symbol s, Type t, Price p, Quantity q, Price f, Tags tags = {},
+  static Transaction Factory(ID id, Date d, InternedSymbol s, Type t, Price p, Quantity q, Price f, Tags tags = {},
                              Comment c = {});
 
   void ToTreeRow(Gtk::TreeRow& row) const;
 
   [[nodiscard]] ValueWithErrorCode<json::Json> Serialize() const override;
 
+  /**
+   * Writes the same JSON object as Serialize(), without building it in memory.
+   */
+  ErrorCode Serialize(JsonWriter& writer) const;
+
+  /**
+   * A tag's key and, if it has one, its value.
+   */
+  using TagView = std::pair<std::string_view, std::optional<std::string_view>>;
+
+  /**
+   * Writes the JSON object of a transaction with the given members, for copies of transactions that are written where
+   * the pools may not be read.
+   */
+  static void Serialize(JsonWriter& writer, Date d, std::string_view s, Type t, Price p, Quantity q, Price f,
+                        const std::vector<TagView>& tags, std::string_view c);
+
   ErrorCode Deserialize(const json::Json& input_json) override;
 
+  /**
+   * Reads the members straight from the reader's next JSON object, without building it in memory.
+   */
+  ErrorCode Deserialize(JsonReader& reader);
+
   // Equality operators only check the id, so it is important that they are unique.
   bool operator==(const Transaction& other) const { return id == other.id; }
   bool operator!=(const Transaction& other) const { return !(*this == other); }
 
   [[nodiscard]] bool MemberwiseEquals(const Transaction& other) const;
 
+  /**
+   * Returns a 64-bit hash of the members that MemberwiseEquals compares, so memberwise equal transactions have equal
+   * fingerprints. It is computed from the members' bytes, without formatting them, but depends on the symbol's interned
+   * ID, so it must not be persisted.
+   */
+  [[nodiscard]] uint64_t Fingerprint() const noexcept;
+
   // Ordering operators correspond to the Transaction's date.
   bool operator<(const Transaction& other) const { return date < other.date; }
   bool operator>(const Transaction& other) const { return date > other.date; }
@@ -138,7 +273,7 @@ struct Transaction : json::JsonBidirectionalSerializable
   /**
    * The transaction's associated symbol
    */
-  Symbol symbol;
+  InternedSymbol symbol;
   /**
    * The kind of transaction
    */
@@ -178,6 +313,9 @@ struct TransactionMemberwiseHasher
 
 /**
  * Static class for managing Transactions.
+ *
+ * Transactions are stored in a slot map, so an ID is a generational handle: lookups index directly into contiguous
+ * storage, and an ID that has been released is never found again even after its slot is reused.
  */
 class TransactionPool
 {
@@ -194,25 +332,54 @@ class TransactionPool
   template <typename... Args>
   static const Transaction& TransactionFactory(Args&&... args)
   {
-    Transaction tr = Transaction::Factory(next_id_++, std::forward<Args>(args)...);
-    const auto [iter, inserted] = transaction_id_map_.emplace(tr.id, std::move(tr));
-    return iter->second;
+    return transactions_.Emplace(
+        [&](TransactionID id) { return Transaction::Factory(id, std::forward<Args>(args)...); });
   }
 
   /**
-   * Returns a pointer to the Transaction with the given ID.
-   * @param id the ID to find
-   * @return valid pointer if found, nullptr if not
+   * Reserves IDs for Transactions that are created later by CreateReserved, for example on several threads.
+   * @param count the number of IDs to reserve
+   * @return the reserved IDs, which count towards Size() but are not found until their Transactions are created
    */
-  static Transaction* Find(TransactionID id)
+  static std::vector<TransactionID> Reserve(std::size_t count) { return transactions_.Reserve(count); }
+
+  /**
+   * Creates a Transaction with a reserved ID, passing the args to the Transaction's factory method. Transactions with
+   * distinct IDs can be created concurrently, as long as nothing else modifies the pool meanwhile.
+   */
+  template <typename... Args>
+  static const Transaction& CreateReserved(TransactionID id, Args&&... args)
   {
-    const auto iter = transaction_id_map_.find(id);
-    return iter != transaction_id_map_.end() ? &iter->second : nullptr;
+    return transactions_.EmplaceAt(
+        id, [&](TransactionID tr_id) { return Transaction::Factory(tr_id, std::forward<Args>(args)...); });
   }
 
+  /**
+   * Releases a reserved ID, destroying its Transaction if it has been created.
+   */
+  static void Unreserve(TransactionID id) { transactions_.Unreserve(id); }
+
+  /**
+   * Returns a pointer to the Transaction with the given ID.
+   * @param id the ID to find
+   * @return valid pointer if found, nullptr if not or if the ID has been released
+   */
+  static Transaction* Find(TransactionID id) { return transactions_.Find(id); }
+
+  /**
+   * Destroys the Transaction with the given ID so that its storage can be reused. The ID will never be found again.
+   * @param id the ID to release
+   * @return true if released, false if not found
+   */
+  static bool Release(TransactionID id) { return transactions_.Erase(id); }
+
+  /**
+   * Returns the number of live Transactions.
+   */
+  static std::size_t Size() noexcept { return transactions_.Size(); }
+
  private:
-  inline static std::unordered_map<TransactionID, Transaction> transaction_id_map_;
-  inline static TransactionID next_id_ = 0;
+  inline static detail::SlotMap<Transaction> transactions_;
 };
 
 }  // namespace inv
\ No newline at end of file
@@ -0,0 +1,111 @@
+/**
+ * @file transaction_columns.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/transaction_columns.h"
+
+#include <algorithm>
+
+#include "invport/detail/parallel.h"
+
+namespace inv
+{
+
+TransactionColumns::TransactionColumns(const TransactionHistory& th) : num_symbols_(SymbolTable::Size())
+{
+  for (const auto& [date, transactions] : th)
+  {
+    for (const auto& id : transactions)
+    {
+      const auto* tr_ptr = TransactionPool::Find(id);
+      if (tr_ptr == nullptr) continue;
+
+      ids_.push_back(id);
+      dates_.push_back(date.ToPrimitive());
+      symbols_.push_back(tr_ptr->symbol.Id());
+      types_.push_back(tr_ptr->type);
+      prices_.push_back(tr_ptr->price);
+      quantities_.push_back(tr_ptr->quantity);
+      fees_.push_back(tr_ptr->fee);
+    }
+  }
+}
+
+std::pair<TransactionColumns::Row, TransactionColumns::Row> TransactionColumns::GetRange(const Date& start_date,
+                                                                                         const Date& end_date) const
+{
+  const auto begin = !start_date.IsZero() ? std::lower_bound(dates_.begin(), dates_.end(), start_date.ToPrimitive())
+                                          : dates_.begin();
+  const auto end =
+      !end_date.IsZero() ? std::upper_bound(begin, dates_.end(), end_date.ToPrimitive()) : dates_.end();
+  return {begin - dates_.begin(), end - dates_.begin()};
+}
+
+std::vector<TransactionColumns::Totals> TransactionColumns::GetTotals(const Date& start_date, const Date& end_date,
+                                                                      std::size_t min_chunk_rows) const
+{
+  const auto [first, last] = GetRange(start_date, end_date);
+
+  // Decimals add exactly, so the totals of each chunk can be summed in any order with the same result.
+  const auto chunks = detail::ParallelChunks(last - first, min_chunk_rows, [&, first = first](Row begin, Row end) {
+    std::vector<Totals> totals(NumSymbols());
+    for (Row r = first + begin; r < first + end; ++r)
+    {
+      auto& t = totals[symbols_[r]];
+      const Price spent = prices_[r] * quantities_[r];
+      if (types_[r] == Transaction::Type::BUY)
+      {
+        t.spent += spent;
+        t.quantity += quantities_[r];
+      }
+      else
+      {
+        t.spent -= spent;
+        t.quantity -= quantities_[r];
+      }
+      t.fees += fees_[r];
+    }
+    return totals;
+  });
+
+  auto totals = chunks.front();
+  for (std::size_t c = 1; c < chunks.size(); ++c)
+    for (std::size_t i = 0; i < totals.size(); ++i) totals[i] += chunks[c][i];
+  return totals;
+}
+
+Price TransactionColumns::GetValuation(const std::vector<Price>& prices, const Date& end_date) const
+{
+  const auto [first, last] = GetRange(Date::Zero(), end_date);
+
+  std::vector<Transaction::Quantity> quantities(NumSymbols());
+  for (Row r = first; r < last; ++r)
+  {
+    if (types_[r] == Transaction::Type::BUY)
+      quantities[symbols_[r]] += quantities_[r];
+    else
+      quantities[symbols_[r]] -= quantities_[r];
+  }
+
+  Price value = 0;
+  const std::size_t n = std::min(quantities.size(), prices.size());
+  for (std::size_t i = 0; i < n; ++i) value += prices[i] * quantities[i];
+  return value;
+}
+
+std::vector<TransactionColumns::Row> TransactionColumns::Select(const Filter& filter) const
+{
+  const auto [first, last] = GetRange(filter.start_date, filter.end_date);
+
+  std::vector<Row> rows;
+  for (Row r = first; r < last; ++r)
+  {
+    if (filter.symbol.has_value() && symbols_[r] != *filter.symbol) continue;
+    if (filter.type.has_value() && types_[r] != *filter.type) continue;
+    rows.push_back(r);
+  }
+  return rows;
+}
+}  // namespace inv
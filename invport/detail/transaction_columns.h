@@ -0,0 +1,124 @@
+/**
+ * @file transaction_columns.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "invport/detail/common.h"
+#include "invport/detail/symbol_table.h"
+#include "invport/detail/transaction_history.h"
+#include "invport/detail/utils.h"
+
+namespace inv
+{
+/**
+ * A read-only, column-oriented snapshot of a TransactionHistory.
+ *
+ * Each numeric field of the history's transactions is copied into its own array, and all arrays are sorted by date.
+ * Aggregations then stream through only the columns they need instead of dragging each Transaction's tags and comment
+ * through cache. Symbols are stored as SymbolTable IDs. The snapshot does not observe later changes to the history.
+ */
+class TransactionColumns
+{
+ public:
+  using Transaction = TransactionHistory::Transaction;
+  using TransactionID = TransactionHistory::TransactionID;
+  using Totals = Transaction::Totals;
+  using SymbolID = SymbolTable::SymbolID;
+  using Row = std::size_t;
+
+  /**
+   * The minimum number of rows per summing thread, so that small snapshots are summed on the calling thread alone.
+   */
+  static constexpr std::size_t kMinChunkRows = 1 << 16;
+
+  /**
+   * Describes which rows to select. Empty members select everything.
+   */
+  struct Filter
+  {
+    Date start_date;
+    Date end_date;
+    std::optional<SymbolID> symbol;
+    std::optional<Transaction::Type> type;
+  };
+
+  /**
+   * Freezes the given history.
+   * @param th the history to copy
+   */
+  explicit TransactionColumns(const TransactionHistory& th);
+
+  [[nodiscard]] std::size_t Size() const noexcept { return dates_.size(); }
+  [[nodiscard]] bool Empty() const noexcept { return dates_.empty(); }
+
+  [[nodiscard]] const std::vector<TransactionID>& Ids() const noexcept { return ids_; }
+  [[nodiscard]] const std::vector<Date::PrimitiveType>& Dates() const noexcept { return dates_; }
+  [[nodiscard]] const std::vector<SymbolID>& Symbols() const noexcept { return symbols_; }
+  [[nodiscard]] const std::vector<Transaction::Type>& Types() const noexcept { return types_; }
+  [[nodiscard]] const std::vector<Price>& Prices() const noexcept { return prices_; }
+  [[nodiscard]] const std::vector<Transaction::Quantity>& Quantities() const noexcept { return quantities_; }
+  [[nodiscard]] const std::vector<Price>& Fees() const noexcept { return fees_; }
+
+  /**
+   * Returns the size of arrays indexed by SymbolID. All symbol IDs in this snapshot are in [0, NumSymbols()).
+   */
+  [[nodiscard]] std::size_t NumSymbols() const noexcept { return num_symbols_; }
+
+  /**
+   * Gets the rows whose dates are within the given bounds.
+   * @param start_date the starting date, inclusive, or zero, which will evaluate from the first row
+   * @param end_date the stopping date, inclusive, or zero, which will evaluate until the last row
+   * @return half-open range of rows
+   */
+  [[nodiscard]] std::pair<Row, Row> GetRange(const Date& start_date = Date::Zero(),
+                                             const Date& end_date = Date::Zero()) const;
+
+  /**
+   * Gets the totals per symbol between the given dates. Equivalent to TransactionHistory::GetTotals.
+   *
+   * The rows are split into chunks that are summed on a thread each. Sums of decimals are exact, so the totals are the
+   * same however the rows are split.
+   * @param start_date the starting date, inclusive, or zero, which will evaluate from the first row
+   * @param end_date the stopping date, inclusive, or zero, which will evaluate until the last row
+   * @param min_chunk_rows the minimum number of rows per thread
+   * @return Totals indexed by SymbolID
+   */
+  [[nodiscard]] std::vector<Totals> GetTotals(const Date& start_date = Date::Zero(),
+                                              const Date& end_date = Date::Zero(),
+                                              std::size_t min_chunk_rows = kMinChunkRows) const;
+
+  /**
+   * Gets the value of all holdings on the given date.
+   * @param prices price per share indexed by SymbolID
+   * @param end_date the date to evaluate holdings on, or zero for all rows
+   * @return the sum of each symbol's quantity multiplied by its price
+   */
+  [[nodiscard]] Price GetValuation(const std::vector<Price>& prices, const Date& end_date = Date::Zero()) const;
+
+  /**
+   * Selects the rows matching the given filter.
+   * @param filter the filter to apply
+   * @return matching rows in date order
+   */
+  [[nodiscard]] std::vector<Row> Select(const Filter& filter) const;
+
+ private:
+  std::vector<TransactionID> ids_;
+  std::vector<Date::PrimitiveType> dates_;
+  std::vector<SymbolID> symbols_;
+  std::vector<Transaction::Type> types_;
+  std::vector<Price> prices_;
+  std::vector<Transaction::Quantity> quantities_;
+  std::vector<Price> fees_;
+
+  std::size_t num_symbols_;
+};
+}  // namespace inv
@@ -8,20 +8,62 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
 namespace inv
 {
-TransactionHistory TransactionHistory::Factory(const file::Path& relative_path, file::Directory directory)
+TransactionHistory TransactionHistory::Factory(const file::Path& relative_path, file::Directory directory,
+                                               file::Extension format, std::chrono::milliseconds flush_window)
 {
-  TransactionHistory th(relative_path, directory);
-  auto vec = th.ReadFile();
-  if (vec.second.Failure())
-    throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(vec.second)));
+  TransactionHistory th(relative_path, directory, format, flush_window);
 
-  if (!vec.first.empty())
+  uint64_t base_hash;
+  if (format == file::BINARY)
   {
-    auto ec = th.Deserialize(json::Json::parse(vec.first));
-    if (ec.Failure()) throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(ec)));
+    auto file = th.MapFile();
+    if (file.second.Failure())
+      throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(file.second)));
+
+    const auto data = file.first.View();
+    if (!data.empty())
+    {
+      auto entries = binary::Decode(data);
+      if (entries.second.Failure())
+        throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(entries.second)));
+      th.Insert(entries.first);
+    }
+    base_hash = binary::Checksum(data);
   }
+  else
+  {
+    auto file = th.MapFile();
+    if (file.second.Failure())
+      throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(file.second)));
+
+    const auto data = file.first.View();
+    if (!data.empty())
+    {
+      detail::JsonReader reader(data);
+      auto ec = th.Deserialize(reader);
+      if (ec.Failure()) throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(ec)));
+    }
+    base_hash = Fnv1a(data);
+  }
+
+  auto records = th.storage_->journal.Load(base_hash);
+  if (records.second.Failure())
+    throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(records.second)));
+
+  auto ec = th.Replay(records.first);
+  if (ec.Failure()) throw std::runtime_error(ErrorCode("TransactionHistory::Factory() failed", std::move(ec)));
+
+  // Everything loaded so far is already on disk.
+  th.pending_.clear();
+  th.pending_adds_.clear();
+  th.journal_size_ = th.storage_->journal.Size();
+  th.compact_ = th.journal_size_ >= th.CompactionThreshold();
   return th;
 }
 
@@ -44,18 +86,21 @@ void TransactionHistory::ToTreeStore(Gtk::TreeStore& tree) const
   }
 }
 
-std::pair<TransactionHistory::Timeline::iterator, bool> TransactionHistory::Remove(const TransactionID& id)
+std::pair<TransactionHistory::Timeline::const_iterator, bool> TransactionHistory::Remove(const TransactionID& id)
 {
   if (const auto* tr_ptr = TransactionPool::Find(id); tr_ptr != nullptr)
   {
-    if (const auto iter = timeline_.find(tr_ptr->date); iter != timeline_.end())
+    auto result = timeline_.Erase(tr_ptr->date, id);
+
+    // Erase only returns end() without emptying a bucket when the id was not found.
+    if (result.first != timeline_.end() || result.second)
     {
-      if (iter->second.erase(id))
-      {
-        if (iter->second.empty()) return {timeline_.erase(iter), true};
-        return {iter, false};
-      }
+      tag_index_.Erase(id, tr_ptr->tags);
+      totals_index_.Erase(*tr_ptr);
+      fingerprint_index_.Erase(*tr_ptr);
+      LogRemove(*tr_ptr);
     }
+    return result;
   }
   return {timeline_.end(), false};
 }
@@ -63,63 +108,106 @@ std::pair<TransactionHistory::Timeline::iterator, bool> TransactionHistory::Remo
 void TransactionHistory::Merge(const TransactionHistory& other,
                                const std::unordered_set<TransactionHistory::Transaction::Tag>& exclude_tags)
 {
-  TransactionSet exclude_set;
-  for (const auto& tag : exclude_tags) exclude_set.merge(GetAssociatedTransactions(tag));
-
-  for (const auto& [date, trs] : other)
+  std::vector<const detail::TagIndex::PostingList*> exclude_lists;
+  for (const auto& tag : exclude_tags)
   {
-    auto& date_ref = timeline_[date];
-    for (const auto& tr_id : trs)
-      if (!exclude_set.count(tr_id)) date_ref.insert(tr_id);
+    const auto key = Transaction::Tags::Find(tag);
+    if (!key.has_value()) continue;
+    if (const auto* list = tag_index_.Find(*key); list != nullptr) exclude_lists.push_back(list);
   }
-}
 
-[[nodiscard]] iex::SymbolMap<TransactionHistory::Totals> TransactionHistory::GetTotals(const Date& start_date,
-                                                                                       const Date& end_date) const
-{
-  const auto begin = !start_date.IsZero() ? timeline_.lower_bound(start_date) : timeline_.begin();
-  const auto end = !end_date.IsZero() ? timeline_.upper_bound(end_date) : timeline_.end();
+  const auto excluded = [&exclude_lists](TransactionID id) {
+    return std::any_of(exclude_lists.begin(), exclude_lists.end(),
+                       [id](const auto* list) { return list->count(id) != 0; });
+  };
 
-  iex::SymbolMap<TransactionHistory::Totals> map;
-  for (auto iter = begin; iter != end; ++iter)
+  std::vector<std::pair<Date::PrimitiveType, TransactionID>> entries;
+  std::vector<const Transaction*> added;
+  entries.reserve(other.timeline_.size());
+  added.reserve(other.timeline_.size());
+  for (const auto& [date, trs] : other)
   {
-    for (const auto& id : iter->second)
+    const auto existing = timeline_.at(date);
+    for (const auto& tr_id : trs)
     {
-      const auto* tr_ptr = TransactionPool::Find(id);
-      if (tr_ptr)
+      if (excluded(tr_id) || existing.count(tr_id)) continue;
+      entries.emplace_back(date.ToPrimitive(), tr_id);
+
+      if (const auto* tr_ptr = TransactionPool::Find(tr_id); tr_ptr != nullptr)
       {
-        map[tr_ptr->symbol] += Totals(*tr_ptr);
+        tag_index_.Insert(tr_id, tr_ptr->tags);
+        fingerprint_index_.Insert(*tr_ptr);
+        added.push_back(tr_ptr);
       }
+      LogAdd(tr_id);
     }
   }
-  return map;
+  timeline_.Insert(entries);
+  totals_index_.Insert(std::move(added));
 }
 
-TransactionHistory::TransactionSet TransactionHistory::GetAssociatedTransactions(
-    const TransactionHistory::Transaction::Tag& tag)
+std::vector<TransactionHistory::TransactionID> TransactionHistory::MergeMissing(const TransactionHistory& other)
 {
-  TransactionHistory::TransactionSet set;
-  for (const auto& [date, transactions] : timeline_)
+  std::vector<TransactionID> ids;
+  ids.reserve(other.timeline_.size());
+  for (const auto& [date, trs] : other) ids.insert(ids.end(), trs.begin(), trs.end());
+
+  const auto missing = fingerprint_index_.Missing(ids);
+  const std::unordered_set<TransactionID> merged(missing.begin(), missing.end());
+
+  binary::Entries entries;
+  entries.reserve(missing.size());
+  std::vector<TransactionID> skipped;
+  skipped.reserve(ids.size() - missing.size());
+  for (const auto id : ids)
   {
-    for (const auto& id : transactions)
-    {
-      if (TransactionPool::Find(id)->tags.count(tag)) set.insert(id);
-    }
+    if (merged.count(id) != 0)
+      entries.emplace_back(TransactionPool::Find(id)->date.ToPrimitive(), id);
+    else
+      skipped.push_back(id);
   }
-  return set;
+  Insert(entries);
+  return skipped;
+}
+
+[[nodiscard]] iex::SymbolMap<TransactionHistory::Totals> TransactionHistory::GetTotals(const Date& start_date,
+                                                                                       const Date& end_date) const
+{
+  return totals_index_.Query(start_date, end_date);
+}
+
+TransactionHistory::Totals TransactionHistory::GetTotalsAsOf(const Symbol& symbol, const Date& date) const
+{
+  const auto id = SymbolTable::Find(symbol);
+  return id.has_value() ? totals_index_.QueryAsOf(*id, date) : Totals();
+}
+
+TransactionHistory::TransactionSet TransactionHistory::GetAssociatedTransactions(
+    const TransactionHistory::Transaction::Tag& tag) const
+{
+  const auto key = Transaction::Tags::Find(tag);
+  if (!key.has_value()) return {};
+
+  const auto* list = tag_index_.Find(*key);
+  return list != nullptr ? *list : TransactionSet();
+}
+
+TransactionHistory::TransactionSet TransactionHistory::GetAssociatedTransactions(
+    const TransactionHistory::Transaction::Tag& tag, const std::string& value) const
+{
+  const auto key = Transaction::Tags::Find(tag);
+  const auto value_id = Transaction::Tags::Find(value);
+  if (!key.has_value() || !value_id.has_value()) return {};
+
+  const auto* list = tag_index_.Find(*key, *value_id);
+  return list != nullptr ? *list : TransactionSet();
 }
 
 std::unordered_map<TransactionHistory::Transaction::Tag, TransactionHistory::TransactionSet>
-TransactionHistory::GetAssociatedTransactions()
+TransactionHistory::GetAssociatedTransactions() const
 {
   std::unordered_map<TransactionHistory::Transaction::Tag, TransactionHistory::TransactionSet> map;
-  for (const auto& [date, transactions] : timeline_)
-  {
-    for (const auto& id : transactions)
-    {
-      for (const auto& tag : TransactionPool::Find(id)->tags) map[tag.first].insert(id);
-    }
-  }
+  for (const auto& [key, list] : tag_index_.Keys()) map.emplace(Transaction::Tags::GetString(key), list);
   return map;
 }
 
@@ -147,6 +235,25 @@ ValueWithErrorCode<iex::json::Json> TransactionHistory::Serialize() const
 
   return {json, {}};
 }
+ErrorCode TransactionHistory::Serialize(detail::JsonWriter& writer) const
+{
+  writer.BeginArray();
+  for (const auto& [date, transactions] : timeline_)
+  {
+    for (const auto& id : transactions)
+    {
+      const auto* tr_ptr = TransactionPool::Find(id);
+      if (tr_ptr == nullptr)
+        return ErrorCode("TransactionHistory::Serialize() failed", {"id", ErrorCode(std::to_string(id))});
+
+      auto ec = tr_ptr->Serialize(writer);
+      if (ec.Failure()) return ErrorCode("TransactionHistory::Serialize() failed", std::move(ec));
+    }
+  }
+  writer.EndArray();
+  return {};
+}
+
 ErrorCode TransactionHistory::Deserialize(const iex::json::Json& input_json)
 {
   try
@@ -163,6 +270,24 @@ ErrorCode TransactionHistory::Deserialize(const iex::json::Json& input_json)
 
   return {};
 }
+
+ErrorCode TransactionHistory::Deserialize(detail::JsonReader& reader)
+{
+  try
+  {
+    reader.BeginArray();
+    while (reader.HasNext()) Add(reader);
+    reader.EndArray();
+    reader.Finish();
+  }
+  catch (const std::exception& e)
+  {
+    return ErrorCode("TransactionHistory::Deserialize() failed", ErrorCode(e.what()));
+  }
+
+  return {};
+}
+
 bool TransactionHistory::MemberwiseEquals(const TransactionHistory& other) const
 {
   const auto [it1, it2] = std::mismatch(begin(), end(), other.begin(), other.end(), [](const auto& p1, const auto& p2) {
@@ -180,18 +305,231 @@ bool TransactionHistory::MemberwiseEquals(const TransactionHistory& other) const
 
 void TransactionHistory::Flush()
 {
+  // A failed write lost its edits, so everything has to be rewritten.
+  if (storage_->failed.exchange(false)) compact_ = true;
+
   try
   {
-    auto vec = Serialize();
-    if (vec.second.Failure()) throw std::runtime_error(vec.second);
+    if (compact_)
+    {
+      auto snapshot = binary::Snapshot::Factory(timeline_);
+      if (snapshot.second.Failure()) throw std::runtime_error(snapshot.second);
+      storage_->Rewrite(std::move(snapshot.first));
 
-    auto ec = WriteFile(vec.first.dump());
-    if (ec.Failure()) throw std::runtime_error(ec);
+      journal_size_ = 0;
+      compact_ = false;
+    }
+    else
+    {
+      std::vector<detail::Journal::Record> records;
+      records.reserve(pending_.size());
+      for (auto& pending : pending_)
+      {
+        if (pending.operation == detail::Journal::REMOVE)
+        {
+          records.push_back({pending.operation, std::move(pending.transaction)});
+          continue;
+        }
+
+        // Adds that were removed again before this flush cancel out.
+        const auto* tr_ptr = TransactionPool::Find(pending.id);
+        if (tr_ptr == nullptr || pending_adds_.count(pending.id) == 0) continue;
+
+        auto [j_tr, ec] = tr_ptr->Serialize();
+        if (ec.Failure()) throw std::runtime_error(ec);
+        records.push_back({pending.operation, std::move(j_tr)});
+      }
+
+      if (!records.empty())
+      {
+        journal_size_ += records.size();
+        storage_->Append(std::move(records));
+      }
+    }
   }
   catch (const std::exception& e)
   {
+    // The pending edits are lost, so the next flush has to rewrite everything.
+    compact_ = true;
     spdlog::critical(ErrorCode("TransactionHistory::Flush failed", ErrorCode(e.what())));
   }
+
+  pending_.clear();
+  pending_adds_.clear();
+}
+
+void TransactionHistory::AfterFlush(std::function<ErrorCode()> write)
+{
+  storage_->flush_thread.Submit([storage = storage_.get(), write = std::move(write)] {
+    if (storage->lost)
+    {
+      spdlog::warn("Skipping a write that depends on history edits which were lost");
+      return;
+    }
+    if (auto ec = write(); ec.Failure()) spdlog::error(ec);
+  });
+}
+
+void TransactionHistory::Storage::Append(std::vector<detail::Journal::Record> records)
+{
+  {
+    std::lock_guard lock(mutex_);
+    records_.insert(records_.end(), std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+    if (std::exchange(scheduled_, true)) return;
+  }
+  flush_thread.Submit([this] { Write(); });
+}
+
+void TransactionHistory::Storage::Rewrite(binary::Snapshot snapshot)
+{
+  {
+    std::lock_guard lock(mutex_);
+    rewrite_ = std::move(snapshot);
+    records_.clear();
+    if (std::exchange(scheduled_, true)) return;
+  }
+  flush_thread.Submit([this] { Write(); });
+}
+
+void TransactionHistory::Storage::Write()
+{
+  std::optional<binary::Snapshot> rewrite;
+  std::vector<detail::Journal::Record> records;
+  {
+    std::lock_guard lock(mutex_);
+    rewrite = std::exchange(rewrite_, std::nullopt);
+    records = std::exchange(records_, {});
+    scheduled_ = false;
+  }
+
+  if (rewrite)
+  {
+    uint64_t base_hash = 0;
+    auto ec = WriteFile([&](std::ostream& out) {
+      if (format == file::BINARY)
+      {
+        auto written = rewrite->Write(out);
+        base_hash = written.first;
+        return std::move(written.second);
+      }
+
+      detail::JsonWriter writer(out);
+      rewrite->WriteJson(writer);
+      auto flushed = writer.Flush();
+      base_hash = writer.Hash();
+      return flushed;
+    });
+    rewrite.reset();
+    if (ec.Success()) ec = journal.Reset(base_hash);
+    if (ec.Failure()) return Fail(std::move(ec));
+
+    lost = false;
+  }
+
+  // Records that follow lost edits would leave a gap in the journal, and the rewrite that the loss triggers has them.
+  if (records.empty() || lost) return;
+
+  auto ec = journal.Append(records);
+  if (ec.Failure()) Fail(std::move(ec));
+}
+
+void TransactionHistory::Storage::Fail(ErrorCode ec)
+{
+  failed = true;
+  lost = true;
+  spdlog::critical(ErrorCode("TransactionHistory::Flush failed", std::move(ec)));
+}
+
+void TransactionHistory::Insert(const binary::Entries& entries)
+{
+  std::vector<const Transaction*> added;
+  added.reserve(entries.size());
+  for (const auto& [date, id] : entries)
+  {
+    const auto& tr = *TransactionPool::Find(id);
+    tag_index_.Insert(id, tr.tags);
+    fingerprint_index_.Insert(tr);
+    added.push_back(&tr);
+    LogAdd(id);
+  }
+  timeline_.Insert(entries);
+  totals_index_.Insert(std::move(added));
+}
+
+bool TransactionHistory::LogFull()
+{
+  if (!compact_ && journal_size_ + pending_.size() >= CompactionThreshold())
+  {
+    compact_ = true;
+    pending_.clear();
+    pending_adds_.clear();
+  }
+  return compact_;
+}
+
+void TransactionHistory::LogAdd(TransactionID id)
+{
+  if (LogFull()) return;
+
+  pending_.push_back({detail::Journal::ADD, id, {}});
+  pending_adds_.insert(id);
+}
+
+void TransactionHistory::LogRemove(const Transaction& tr)
+{
+  // The add never reached the journal, so there is nothing to undo.
+  if (pending_adds_.erase(tr.id) != 0) return;
+  if (LogFull()) return;
+
+  auto [j_tr, ec] = tr.Serialize();
+  if (ec.Failure())
+  {
+    compact_ = true;
+    return;
+  }
+  pending_.push_back({detail::Journal::REMOVE, tr.id, std::move(j_tr)});
+}
+
+ErrorCode TransactionHistory::Replay(const std::vector<detail::Journal::Record>& records)
+{
+  try
+  {
+    for (const auto& record : records)
+    {
+      if (record.operation == detail::Journal::ADD)
+      {
+        Add(record.transaction);
+        continue;
+      }
+
+      // Transactions are identified by their contents, as IDs are not persisted.
+      const auto& probe = TransactionPool::TransactionFactory(record.transaction);
+      const auto probe_id = probe.id;
+      const auto probe_tags = static_cast<std::unordered_set<Transaction::Tag>>(probe.tags);
+      const auto bucket = timeline_.at(probe.date);
+      const auto match = std::find_if(bucket.begin(), bucket.end(), [&](TransactionID id) {
+        const auto& tr = *TransactionPool::Find(id);
+        return tr.MemberwiseEquals(probe) && tr.comment == probe.comment &&
+               static_cast<std::unordered_set<Transaction::Tag>>(tr.tags) == probe_tags;
+      });
+      const auto match_id = match != bucket.end() ? std::optional<TransactionID>(*match) : std::nullopt;
+      TransactionPool::Release(probe_id);
+
+      if (!match_id.has_value())
+      {
+        spdlog::warn("Journal removes a transaction that does not exist");
+        continue;
+      }
+      Remove(*match_id);
+      TransactionPool::Release(*match_id);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    return ErrorCode("TransactionHistory::Replay() failed", ErrorCode(e.what()));
+  }
+
+  return {};
 }
 
-}  // namespace inv
\ No newline at end of file
+}  // namespace inv
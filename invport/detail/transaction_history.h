@@ -6,11 +6,26 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "invport/detail/binary_format.h"
 #include "invport/detail/common.h"
 #include "invport/detail/file_serializable.h"
+#include "invport/detail/fingerprint_index.h"
+#include "invport/detail/flush_thread.h"
+#include "invport/detail/journal.h"
+#include "invport/detail/tag_index.h"
+#include "invport/detail/timeline.h"
+#include "invport/detail/totals_index.h"
 #include "invport/detail/transaction.h"
 #include "invport/detail/utils.h"
 
@@ -27,7 +42,7 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
   using Totals = Transaction::Totals;
 
   using TransactionSet = std::unordered_set<TransactionID>;
-  using Timeline = std::map<Date, TransactionSet>;
+  using Timeline = detail::Timeline;
 
   using MemberwiseTransactionSet =
       std::unordered_set<TransactionID, detail::TransactionMemberwiseHasher, detail::TransactionMemberwiseComparator>;
@@ -37,8 +52,11 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
 
  private:
   explicit TransactionHistory(const file::Path& relative_path = "transaction_history",
-                              file::Directory directory = file::HOME)
-      : file::FileIoBase(relative_path, directory)
+                              file::Directory directory = file::HOME, file::Extension format = file::JSON,
+                              std::chrono::milliseconds flush_window = detail::FlushThread::kDefaultWindow)
+      : file::FileIoBase(relative_path, directory, format),
+        format_(format),
+        storage_(std::make_unique<Storage>(relative_path, directory, format, flush_window))
   {
   }
 
@@ -49,20 +67,29 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
  public:
   inline static const TempTag kTempTag;
 
-  explicit TransactionHistory(const TempTag&) : file::FileIoBase(std::to_string(std::rand()), file::Directory::TEMP) {}
+  explicit TransactionHistory(const TempTag&) : TransactionHistory(std::to_string(std::rand()), file::Directory::TEMP)
+  {
+  }
 
+  /**
+   * Loads the history from its file, then replays its journal on top.
+   * @param format file::JSON, or file::BINARY for the compact binary format, which loads much faster
+   * @param flush_window how long the flush thread waits for more flushes before writing a burst of them
+   */
   static TransactionHistory Factory(const file::Path& relative_path = "transaction_history",
-                                    file::Directory directory = file::HOME);
+                                    file::Directory directory = file::HOME, file::Extension format = file::JSON,
+                                    std::chrono::milliseconds flush_window = detail::FlushThread::kDefaultWindow);
 
   void ToTreeStore(Gtk::TreeStore& tree) const;
 
-  auto begin() { return timeline_.begin(); }
-  auto end() { return timeline_.end(); }
   [[nodiscard]] auto begin() const { return timeline_.begin(); }
   [[nodiscard]] auto end() const { return timeline_.end(); }
-  auto Find(const Date& date) { return timeline_.find(date); }
   [[nodiscard]] auto Find(const Date& date) const { return timeline_.find(date); }
-  auto operator[](const Date& date) { return timeline_[date]; }
+  [[nodiscard]] TransactionSet operator[](const Date& date) const
+  {
+    const auto bucket = timeline_.at(date);
+    return {bucket.begin(), bucket.end()};
+  }
 
   /**
    * Adds a transaction to the timeline.
@@ -73,7 +100,11 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
   TransactionID Add(Args&&... args)
   {
     const auto& tr = TransactionPool::TransactionFactory(std::forward<Args>(args)...);
-    timeline_[tr.date].insert(tr.id);
+    timeline_.Insert(tr.date, tr.id);
+    tag_index_.Insert(tr.id, tr.tags);
+    totals_index_.Insert(tr);
+    fingerprint_index_.Insert(tr);
+    LogAdd(tr.id);
     return tr.id;
   }
 
@@ -81,7 +112,7 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
    * Removes a transaction from the timeline.
    * @param id the id of the transaction to remove
    */
-  std::pair<Timeline::iterator, bool> Remove(const TransactionID& id);
+  std::pair<Timeline::const_iterator, bool> Remove(const TransactionID& id);
 
   /**
    * Merges two TransactionHistorys
@@ -89,7 +120,17 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
   void Merge(const TransactionHistory& other, const std::unordered_set<Transaction::Tag>& exclude_tags = {});
 
   /**
-   * Gets the total number of shares per symbol until then given date.
+   * Merges the transactions of other that this history does not have yet, such as those of an import that overlaps
+   * the history. Duplicates are counted: if this history has n transactions memberwise equal to one of other's, only
+   * the duplicates of it past the first n are merged. Runs in time linear in the size of other.
+   * @param other the history to merge
+   * @return the ids of other's transactions that were not merged, which the caller may release
+   */
+  std::vector<TransactionID> MergeMissing(const TransactionHistory& other);
+
+  /**
+   * Gets the total number of shares per symbol until then given date. Answered from the totals index in logarithmic
+   * time per symbol.
    * @param start_date the starting date, inclusive, or zero, which will evaluate from begin()
    * @param end_date the stopping date, inclusive, or zero, which will evaluate until end()
    * @return symbol map Totals
@@ -97,14 +138,58 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
   [[nodiscard]] iex::SymbolMap<Totals> GetTotals(const Date& start_date = Date::Zero(),
                                                  const Date& end_date = Date::Zero()) const;
 
-  [[nodiscard]] TransactionSet GetAssociatedTransactions(const Transaction::Tag& tag);
+  /**
+   * Gets the totals per symbol as of the given date, such as the holdings on that day. Each lookup is a binary search
+   * plus a short replay from the nearest checkpoint, so evaluating many dates is cheap.
+   * @param date the date to evaluate, inclusive, or zero for all transactions
+   * @return symbol map Totals
+   */
+  [[nodiscard]] iex::SymbolMap<Totals> GetTotalsAsOf(const Date& date) const { return totals_index_.QueryAsOf(date); }
 
-  [[nodiscard]] std::unordered_map<Transaction::Tag, TransactionSet> GetAssociatedTransactions();
+  /**
+   * Gets one symbol's totals as of the given date.
+   * @param symbol the symbol to evaluate
+   * @param date the date to evaluate, inclusive, or zero for all transactions
+   * @return Totals, which are zero if there are no matching transactions
+   */
+  [[nodiscard]] Totals GetTotalsAsOf(const Symbol& symbol, const Date& date) const;
+
+  /**
+   * Gets the transactions that have the given tag, regardless of its value.
+   * @param tag the tag key
+   * @return set of matching transaction ids
+   */
+  [[nodiscard]] TransactionSet GetAssociatedTransactions(const Transaction::Tag& tag) const;
+
+  /**
+   * Gets the transactions that have the given tag with the given value, such as acc#=12345.
+   * @param tag the tag key
+   * @param value the tag value
+   * @return set of matching transaction ids
+   */
+  [[nodiscard]] TransactionSet GetAssociatedTransactions(const Transaction::Tag& tag, const std::string& value) const;
+
+  /**
+   * Gets the transactions associated with each tag key.
+   * @return map of tag key to set of transaction ids
+   */
+  [[nodiscard]] std::unordered_map<Transaction::Tag, TransactionSet> GetAssociatedTransactions() const;
 
   [[nodiscard]] ValueWithErrorCode<json::Json> Serialize() const final;
 
+  /**
+   * Writes the same JSON array as Serialize(), one transaction at a time, so memory use does not grow with the size of
+   * the history.
+   */
+  ErrorCode Serialize(detail::JsonWriter& writer) const;
+
   ErrorCode Deserialize(const json::Json& input_json) final;
 
+  /**
+   * Adds each transaction of the reader's next JSON array as it is read, without building the array in memory.
+   */
+  ErrorCode Deserialize(detail::JsonReader& reader);
+
   friend bool operator==(const TransactionHistory& lhs, const TransactionHistory& rhs)
   {
     return lhs.timeline_ == rhs.timeline_;
@@ -114,9 +199,148 @@ class TransactionHistory : public json::JsonBidirectionalSerializable, public fi
 
   [[nodiscard]] bool MemberwiseEquals(const TransactionHistory& other) const;
 
+  /**
+   * Persists the edits made since the last flush. Usually this appends them to the journal. Once the journal holds
+   * half as many records as the history has transactions, the whole history is rewritten and the journal is reset
+   * instead, so the cost per edit stays amortized O(1).
+   *
+   * The edits are serialized on the calling thread, but written on the flush thread, so this never blocks on disk. The
+   * records of flushes that the flush thread has not gotten to yet are appended in one write, and a rewrite drops them.
+   * Use Sync() to wait for the writes to finish.
+   *
+   * A rewrite copies the transactions into a binary::Snapshot, which costs about as much memory as the binary file, 48
+   * bytes per transaction and 8 per tag plus each distinct string once, until it is written. The flush thread encodes
+   * the snapshot straight into the file in 1 MiB chunks, so neither format's contents are ever held in memory whole.
+   */
   void Flush();
 
+  /**
+   * Blocks until every flush so far has been written to disk.
+   */
+  void Sync() { storage_->flush_thread.Wait(); }
+
+  /**
+   * Queues a write of another file that records something about the history, such as which rows were imported into
+   * it. The write runs on the flush thread after the writes of every flush so far, so the file is never ahead of the
+   * history on disk. It is skipped if the history has lost edits to a failed write that has not been rewritten yet, but
+   * a rewrite that is flushed after it never drops it.
+   * @param write the write to perform, which must not refer to state that the calling thread may change
+   */
+  void AfterFlush(std::function<ErrorCode()> write);
+
+  /**
+   * Returns a random ID that identifies the history's file across rewrites, such as for files that record something
+   * about it. It changes if the file is replaced by one that its journal was not written against, and is zero if the
+   * history was not loaded by Factory().
+   */
+  [[nodiscard]] uint64_t Identity() const noexcept { return storage_->journal.Id(); }
+
  private:
+  /**
+   * An edit that has not been flushed yet. Adds are serialized when flushed, but removes are serialized right away, as
+   * the transaction is usually released soon after.
+   */
+  struct PendingRecord
+  {
+    detail::Journal::Operation operation;
+    TransactionID id;
+    json::Json transaction;
+  };
+
+  /**
+   * The files that the history is written to. They live on the heap, so that writes queued on the flush thread stay
+   * valid when the history is moved.
+   */
+  class Storage : public file::FileIoBase
+  {
+   public:
+    Storage(const file::Path& relative_path, file::Directory directory, file::Extension extension,
+            std::chrono::milliseconds flush_window)
+        : file::FileIoBase(relative_path, directory, extension),
+          format(extension),
+          journal(relative_path, directory),
+          flush_thread(flush_window)
+    {
+    }
+
+    /**
+     * Queues records to be appended to the journal. Records that are queued before the flush thread gets to them are
+     * appended together, in one write.
+     * @param records the records to append
+     */
+    void Append(std::vector<detail::Journal::Record> records);
+
+    /**
+     * Queues a rewrite of the history, which makes the records that have not been appended yet redundant. The writes
+     * queued by others, such as through AfterFlush(), still run after it. The flush thread streams the snapshot to the
+     * file in the history's format, and resets the journal to the hash of what it wrote.
+     * @param snapshot a copy of the history's transactions
+     */
+    void Rewrite(binary::Snapshot snapshot);
+
+    const file::Extension format;
+    detail::Journal journal;
+    std::atomic<bool> failed{false};
+    bool lost = false;  // Whether a write failed since the last rewrite. Only used on the flush thread.
+
+   private:
+    /**
+     * Writes the pending rewrite, then the pending records. Called on the flush thread.
+     */
+    void Write();
+
+    /**
+     * Logs a failed write and marks the edits as lost. Called on the flush thread.
+     */
+    void Fail(ErrorCode ec);
+
+    std::mutex mutex_;
+    std::optional<binary::Snapshot> rewrite_;
+    std::vector<detail::Journal::Record> records_;
+    bool scheduled_ = false;  // Whether a write that takes what is pending has been submitted, but not started.
+
+   public:
+    detail::FlushThread flush_thread;  // This member must be last, so that queued writes finish before the others die.
+  };
+
+  /**
+   * The minimum number of journal records before compacting, so that small histories are not rewritten on every edit.
+   */
+  static constexpr const std::size_t kMinCompactionRecords = 1024;
+
+  [[nodiscard]] std::size_t CompactionThreshold() const
+  {
+    return std::max(kMinCompactionRecords, timeline_.size() / 2);
+  }
+
+  /**
+   * Returns whether the next flush will rewrite the whole history, in which case edits need not be recorded.
+   */
+  bool LogFull();
+
+  void LogAdd(TransactionID id);
+
+  void LogRemove(const Transaction& tr);
+
+  ErrorCode Replay(const std::vector<detail::Journal::Record>& records);
+
+  /**
+   * Adds transactions that are already in the TransactionPool.
+   * @param entries (date, id) pairs in date order
+   */
+  void Insert(const binary::Entries& entries);
+
+  const file::Extension format_;
+
   Timeline timeline_;
+  detail::TagIndex tag_index_;
+  detail::TotalsIndex totals_index_;
+  detail::FingerprintIndex fingerprint_index_;
+
+  std::unique_ptr<Storage> storage_;
+  std::size_t journal_size_ = 0;  // Includes records that are queued on the flush thread.
+  std::vector<PendingRecord> pending_;
+  std::unordered_set<TransactionID> pending_adds_;
+  bool compact_ = true;
 };
 }  // namespace inv
\ No newline at end of file
@@ -0,0 +1,465 @@
+/**
+ * @file uring_backend.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/uring_backend.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace inv::file
+{
+namespace
+{
+/**
+ * The largest write that a single operation performs, as the kernel writes at most a little under 2 GiB at once.
+ */
+constexpr const std::size_t kMaxWriteBytes = std::size_t{1} << 30;
+
+/**
+ * The bits of an operation's user data that hold its index in the batch. The rest hold the batch's ID.
+ */
+constexpr const unsigned kIndexBits = 16;
+
+int Setup(const unsigned entries, io_uring_params& params)
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int Enter(const int fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags)
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int Register(const int fd, const unsigned opcode, const void* arg, const unsigned nr_args)
+{
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+ErrorCode SystemError(const std::string& call, const int error)
+{
+  return ErrorCode(call + " failed", {"error", ErrorCode(strerror(error))});
+}
+
+/**
+ * Returns the error of an operation's completion, if it failed.
+ * @param result the completion's result
+ * @param length the bytes that the operation writes, or zero if it does not write
+ * @param request the request that the operation performs
+ */
+ErrorCode OperationError(const int result, const std::size_t length, const IoRequest& request)
+{
+  if (result >= 0 && (length == 0 || static_cast<std::size_t>(result) == length)) return {};
+
+  ErrorCode error = result < 0 ? ErrorCode(strerror(-result)) : ErrorCode("short write");
+  return ErrorCode("io_uring request failed",
+                   {{"type", ErrorCode(std::to_string(static_cast<int>(request.type)))},
+                    {"path", ErrorCode(request.path.string())},
+                    {"error", std::move(error)}});
+}
+
+/**
+ * Returns whether an operation has to end its chain, because the kernel does not cancel the rest of a chain when it
+ * fails.
+ */
+bool EndsChain(const uint8_t opcode) { return opcode == IORING_OP_FSYNC || opcode == IORING_OP_RENAMEAT; }
+}  // namespace
+
+ValueWithErrorCode<std::unique_ptr<UringBackend>> UringBackend::Factory(const unsigned entries)
+{
+  std::unique_ptr<UringBackend> backend(new UringBackend());
+
+  io_uring_params params{};
+  backend->ring_fd_ = Setup(entries, params);
+  if (backend->ring_fd_ < 0) return {nullptr, SystemError("io_uring_setup", errno)};
+
+  if ((params.features & IORING_FEAT_LINKED_FILE) == 0)
+  {
+    return {nullptr, ErrorCode("io_uring cannot open files for the rest of a chain")};
+  }
+
+  // Every operation that a chain uses must be supported.
+  std::vector<unsigned char> probe_buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+  if (Register(backend->ring_fd_, IORING_REGISTER_PROBE, probe, 256) < 0)
+  {
+    return {nullptr, SystemError("IORING_REGISTER_PROBE", errno)};
+  }
+  for (const auto opcode : {IORING_OP_NOP, IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_RENAMEAT})
+  {
+    if (opcode >= probe->ops_len || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+    {
+      return {nullptr, ErrorCode("io_uring operation is not supported", {"opcode", ErrorCode(std::to_string(opcode))})};
+    }
+  }
+
+  backend->entries_ = params.sq_entries;
+  backend->sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  backend->cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+  {
+    backend->sq_ring_bytes_ = backend->cq_ring_bytes_ = std::max(backend->sq_ring_bytes_, backend->cq_ring_bytes_);
+  }
+
+  backend->sq_ring_ = mmap(nullptr, backend->sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           backend->ring_fd_, IORING_OFF_SQ_RING);
+  if (backend->sq_ring_ == MAP_FAILED)
+  {
+    backend->sq_ring_ = nullptr;
+    return {nullptr, SystemError("mmap", errno)};
+  }
+
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+  {
+    backend->cq_ring_ = backend->sq_ring_;
+  }
+  else
+  {
+    backend->cq_ring_ = mmap(nullptr, backend->cq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             backend->ring_fd_, IORING_OFF_CQ_RING);
+    if (backend->cq_ring_ == MAP_FAILED)
+    {
+      backend->cq_ring_ = nullptr;
+      return {nullptr, SystemError("mmap", errno)};
+    }
+  }
+
+  backend->sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, backend->sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    backend->ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) return {nullptr, SystemError("mmap", errno)};
+  backend->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  auto* sq = static_cast<char*>(backend->sq_ring_);
+  backend->sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  backend->sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  backend->sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  backend->sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  auto* cq = static_cast<char*>(backend->cq_ring_);
+  backend->cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  backend->cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  backend->cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  backend->cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // A chain opens at most one file per operation, so there are as many slots as entries.
+  const std::vector<int> sparse(backend->entries_, -1);
+  if (Register(backend->ring_fd_, IORING_REGISTER_FILES, sparse.data(), backend->entries_) < 0)
+  {
+    return {nullptr, SystemError("IORING_REGISTER_FILES", errno)};
+  }
+  for (unsigned slot = backend->entries_; slot-- > 0;) backend->free_slots_.push_back(slot);
+
+  backend->reaper_ = std::thread(&UringBackend::Reap, backend.get());
+  return {std::move(backend), ErrorCode()};
+}
+
+UringBackend::~UringBackend()
+{
+  if (reaper_.joinable())
+  {
+    std::unique_lock lock(mutex_);
+    room_cv_.wait(lock, [this] { return batches_.empty(); });
+
+    // A no-op with no batch tells the reaping thread to stop.
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    std::memset(&sqes_[index], 0, sizeof(io_uring_sqe));
+    sqes_[index].opcode = IORING_OP_NOP;
+    sqes_[index].user_data = 0;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    Enter();
+    lock.unlock();
+
+    reaper_.join();
+  }
+
+  if (sqes_ != nullptr) munmap(sqes_, sqes_bytes_);
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_bytes_);
+  if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_bytes_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+void UringBackend::Submit(std::vector<IoRequest> batch, Callback on_complete)
+{
+  Batch pending{std::move(batch), std::move(on_complete), {}, {}, {}, 0, 0};
+  if (pending.requests.empty())
+  {
+    pending.on_complete({});
+    return;
+  }
+
+  const unsigned num_slots = Plan(pending);
+  if (pending.operations.size() > entries_)
+  {
+    pending.on_complete(ErrorCode("io_uring batch is larger than the ring",
+                                  {"operations", ErrorCode(std::to_string(pending.operations.size()))}));
+    return;
+  }
+
+  std::unique_lock lock(mutex_);
+  room_cv_.wait(lock, [this, &pending, num_slots] {
+    return in_flight_ + pending.operations.size() <= entries_ && free_slots_.size() >= num_slots;
+  });
+
+  for (unsigned i = 0; i < num_slots; ++i)
+  {
+    pending.slots.push_back(free_slots_.back());
+    free_slots_.pop_back();
+  }
+  for (auto& operation : pending.operations)
+  {
+    if (operation.opcode != IORING_OP_RENAMEAT) operation.slot = pending.slots[operation.slot];
+  }
+  pending.results.assign(pending.operations.size(), 0);
+  in_flight_ += pending.operations.size();
+
+  const auto id = next_id_++;
+  Queue(batches_.emplace(id, std::move(pending)).first->second, id);
+  Enter();
+}
+
+unsigned UringBackend::Plan(Batch& batch)
+{
+  enum Mode
+  {
+    READ,
+    WRITE,
+    APPEND
+  };
+
+  // The slot that each path is open in, and the mode it was opened in. Files in slots are never inherited by children,
+  // so they are opened without O_CLOEXEC, which the kernel rejects for them.
+  std::unordered_map<std::string, std::pair<unsigned, Mode>> open;
+  unsigned num_slots = 0;
+
+  const auto open_file = [&](const std::size_t request, const Mode mode, const int flags) {
+    const auto& path = batch.requests[request].path.string();
+    const auto it = open.find(path);
+    if (it != open.end() && (it->second.second == mode || mode == READ) && (flags & O_TRUNC) == 0)
+    {
+      return it->second.first;
+    }
+
+    const auto slot = num_slots++;
+    batch.operations.push_back({IORING_OP_OPENAT, request, slot, flags});
+    open[path] = {slot, mode};
+    return slot;
+  };
+
+  for (std::size_t i = 0; i < batch.requests.size(); ++i)
+  {
+    const auto& request = batch.requests[i];
+    switch (request.type)
+    {
+      case IoRequest::CREATE:
+      {
+        open_file(i, WRITE, O_WRONLY | O_CREAT | O_TRUNC);
+        break;
+      }
+      case IoRequest::WRITE:
+      case IoRequest::APPEND:
+      {
+        const bool append = request.type == IoRequest::APPEND;
+        const auto slot =
+            append ? open_file(i, APPEND, O_WRONLY | O_CREAT | O_APPEND) : open_file(i, WRITE, O_WRONLY | O_CREAT);
+        for (std::size_t offset = 0; offset < request.data.size(); offset += kMaxWriteBytes)
+        {
+          const auto length = std::min(kMaxWriteBytes, request.data.size() - offset);
+          batch.operations.push_back({IORING_OP_WRITE, i, slot, 0, offset, length});
+        }
+        break;
+      }
+      case IoRequest::FSYNC:
+      {
+        const auto slot = open_file(i, READ, O_RDONLY);
+        batch.operations.push_back({IORING_OP_FSYNC, i, slot});
+        break;
+      }
+      case IoRequest::RENAME:
+      {
+        open.erase(request.path.string());
+        open.erase(request.target.string());
+        batch.operations.push_back({IORING_OP_RENAMEAT, i});
+        break;
+      }
+    }
+  }
+
+  return num_slots;
+}
+
+void UringBackend::Queue(Batch& batch, const uint64_t id)
+{
+  std::size_t last = batch.next;
+  while (last + 1 < batch.operations.size() && !EndsChain(batch.operations[last].opcode)) ++last;
+  batch.pending = last + 1 - batch.next;
+
+  unsigned tail = *sq_tail_;
+  for (; batch.next <= last; ++batch.next)
+  {
+    const auto i = batch.next;
+    const auto& operation = batch.operations[i];
+    const auto& request = batch.requests[operation.request];
+    const unsigned index = tail++ & sq_mask_;
+    auto& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = operation.opcode;
+    sqe.user_data = (id << kIndexBits) | i;
+    if (i != last) sqe.flags |= IOSQE_IO_LINK;
+
+    switch (operation.opcode)
+    {
+      case IORING_OP_OPENAT:
+      {
+        sqe.fd = AT_FDCWD;
+        sqe.addr = reinterpret_cast<uint64_t>(request.path.c_str());
+        sqe.len = 0644;
+        sqe.open_flags = static_cast<uint32_t>(operation.open_flags);
+        sqe.file_index = operation.slot + 1;
+        break;
+      }
+      case IORING_OP_WRITE:
+      {
+        sqe.flags |= IOSQE_FIXED_FILE;
+        sqe.fd = static_cast<int32_t>(operation.slot);
+        sqe.addr = reinterpret_cast<uint64_t>(request.data.data() + operation.data_offset);
+        sqe.len = static_cast<uint32_t>(operation.length);
+        // Appends write at the end of the file, which the offset of the current position leaves to the file.
+        sqe.off = request.type == IoRequest::APPEND ? ~uint64_t{0} : request.offset + operation.data_offset;
+        break;
+      }
+      case IORING_OP_FSYNC:
+      {
+        sqe.flags |= IOSQE_FIXED_FILE;
+        sqe.fd = static_cast<int32_t>(operation.slot);
+        break;
+      }
+      case IORING_OP_RENAMEAT:
+      {
+        sqe.fd = AT_FDCWD;
+        sqe.addr = reinterpret_cast<uint64_t>(request.path.c_str());
+        sqe.len = static_cast<uint32_t>(AT_FDCWD);
+        sqe.addr2 = reinterpret_cast<uint64_t>(request.target.c_str());
+        break;
+      }
+      default:
+        break;
+    }
+    sq_array_[index] = index;
+  }
+
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+}
+
+void UringBackend::Enter()
+{
+  while (true)
+  {
+    const unsigned queued = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (queued == 0) return;
+
+    if (::inv::file::Enter(ring_fd_, queued, 0, 0) < 0)
+    {
+      const int error = errno;
+      if (error == EINTR || error == EAGAIN || error == EBUSY)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      // The submissions stay queued and are handed over by the next call.
+      spdlog::critical(SystemError("io_uring_enter", error));
+      return;
+    }
+  }
+}
+
+ErrorCode UringBackend::Result(const Batch& batch)
+{
+  for (std::size_t i = 0; i < batch.next; ++i)
+  {
+    const auto& operation = batch.operations[i];
+    const auto length = operation.opcode == IORING_OP_WRITE ? operation.length : 0;
+    auto ec = OperationError(batch.results[i], length, batch.requests[operation.request]);
+    if (ec.Failure()) return ec;
+  }
+  return {};
+}
+
+void UringBackend::Reap()
+{
+  bool stop = false;
+  while (!stop)
+  {
+    if (::inv::file::Enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+    {
+      spdlog::critical(SystemError("io_uring_enter", errno));
+      continue;
+    }
+
+    std::vector<Batch> completed;
+    {
+      std::lock_guard lock(mutex_);
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head)
+      {
+        const auto& cqe = cqes_[head & cq_mask_];
+        if (cqe.user_data == 0)
+        {
+          stop = true;
+          continue;
+        }
+
+        const auto it = batches_.find(cqe.user_data >> kIndexBits);
+        if (it == batches_.end()) continue;
+
+        auto& batch = it->second;
+        batch.results[cqe.user_data & ((uint64_t{1} << kIndexBits) - 1)] = cqe.res;
+        --in_flight_;
+        if (--batch.pending != 0) continue;
+
+        // The rest of the batch is reserved in the ring, so the next chain can be queued right away.
+        if (batch.next < batch.operations.size() && Result(batch).Success())
+        {
+          Queue(batch, it->first);
+          Enter();
+          continue;
+        }
+        in_flight_ -= batch.operations.size() - batch.next;
+
+        // Releasing the slots closes the files that the chain opened, even if the chain failed before closing them.
+        for (const auto slot : batch.slots)
+        {
+          const int none = -1;
+          io_uring_files_update update{slot, 0, reinterpret_cast<uint64_t>(&none)};
+          Register(ring_fd_, IORING_REGISTER_FILES_UPDATE, &update, 1);
+          free_slots_.push_back(slot);
+        }
+        completed.push_back(std::move(batch));
+        batches_.erase(it);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    room_cv_.notify_all();
+
+    for (auto& batch : completed) batch.on_complete(Result(batch));
+  }
+}
+}  // namespace inv::file
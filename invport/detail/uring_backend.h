@@ -0,0 +1,139 @@
+/**
+ * @file uring_backend.h
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "invport/detail/common.h"
+#include "invport/detail/file_serializable.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace inv::file
+{
+/**
+ * Performs batches through a Linux io_uring, so that the kernel performs the writes while the submitting thread goes
+ * on, with no thread per write.
+ *
+ * Each batch becomes chains of linked submissions. The files it uses are opened by the chains themselves into slots of
+ * a registered file table, and the slots are released once the batch completes. A failed write or open cancels the rest
+ * of its chain, but a failed fsync or rename does not, so those end their chain, and the next chain is only queued once
+ * they succeed. A single thread reaps the completions, queues the next chains and calls the callbacks.
+ *
+ * This needs Linux 5.17 or later, for opening into a slot that a later submission of the same chain uses.
+ */
+class UringBackend : public IoBackend
+{
+ public:
+  static constexpr const unsigned kDefaultEntries = 64;
+
+  /**
+   * Creates a ring.
+   * @param entries how many submissions may be in flight at once, which also limits the size of a batch
+   * @return UringBackend if success, or ErrorCode if the kernel does not support io_uring or forbids it
+   */
+  static ValueWithErrorCode<std::unique_ptr<UringBackend>> Factory(unsigned entries = kDefaultEntries);
+
+  UringBackend(const UringBackend&) = delete;
+  UringBackend& operator=(const UringBackend&) = delete;
+
+  /**
+   * Waits for the batches in flight, then stops the reaping thread and closes the ring.
+   */
+  ~UringBackend() override;
+
+  /**
+   * Submits a batch, blocking only while the ring is full. A batch that needs more submissions than the ring has
+   * entries fails without being performed.
+   * @see IoBackend::Submit
+   */
+  void Submit(std::vector<IoRequest> batch, Callback on_complete) override;
+
+ private:
+  /**
+   * One submission of a batch's chain.
+   */
+  struct Operation
+  {
+    uint8_t opcode;
+    std::size_t request;  // The index of the request in the batch.
+    unsigned slot = 0;    // The file slot, counted from zero within the batch until the chain is submitted.
+    int open_flags = 0;
+    std::size_t data_offset = 0;
+    std::size_t length = 0;
+  };
+
+  struct Batch
+  {
+    std::vector<IoRequest> requests;
+    Callback on_complete;
+    std::vector<Operation> operations;
+    std::vector<int> results;
+    std::vector<unsigned> slots;
+    std::size_t next;     // The first operation that has not been queued yet.
+    std::size_t pending;  // The operations of the queued chain that have not completed yet.
+  };
+
+  UringBackend() = default;
+
+  /**
+   * Turns a batch's requests into operations, opening each file once per mode in which it is used.
+   * @return the number of slots that the batch uses
+   */
+  static unsigned Plan(Batch& batch);
+
+  /**
+   * Writes a batch's next chain to the submission ring. The caller must hold the mutex.
+   */
+  void Queue(Batch& batch, uint64_t id);
+
+  /**
+   * Hands the queued submissions to the kernel. The caller must hold the mutex.
+   */
+  void Enter();
+
+  /**
+   * Returns the error of the first queued operation of a batch that failed, if any.
+   */
+  static ErrorCode Result(const Batch& batch);
+
+  void Reap();
+
+  int ring_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  std::size_t sq_ring_bytes_ = 0;
+  std::size_t cq_ring_bytes_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqes_bytes_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned cq_mask_ = 0;
+  unsigned entries_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable room_cv_;
+  std::unordered_map<uint64_t, Batch> batches_;
+  std::vector<unsigned> free_slots_;
+  uint64_t next_id_ = 1;  // Zero is the wake-up that stops the reaping thread.
+  unsigned in_flight_ = 0;
+
+  std::thread reaper_;
+};
+}  // namespace inv::file
@@ -6,71 +6,94 @@
 
 #include "invport/detail/utils.h"
 
-#include <fstream>
+#include <algorithm>
+#include <array>
 
 namespace inv
 {
 const Date Date::kZero;
 
-std::stringstream Read(const std::filesystem::path& path)
+std::vector<std::string_view> SplitLines(std::string_view data)
 {
-  std::ifstream ifstream(path);
-  std::stringstream sstr;
-  sstr << ifstream.rdbuf();
-  return sstr;
+  std::vector<std::string_view> lines;
+  while (!data.empty())
+  {
+    const auto end = std::min(data.find('\n'), data.size());
+    lines.push_back(data.substr(0, end));
+    data.remove_prefix(std::min(end + 1, data.size()));
+  }
+  return lines;
 }
 
-std::vector<std::string> Split(std::stringstream sstr)
+Date::Date(std::string_view str, Format format)
 {
-  std::vector<std::string> lines;
-  std::string line;
-  while (std::getline(sstr, line)) lines.emplace_back(std::move(line));
-  return lines;
+  if (const char* error = Parse(str, format, *this)) throw std::runtime_error(error);
 }
 
-Date::Date(const std::string& str, Format format)
+std::optional<Date> Date::TryParse(std::string_view str, Format format) noexcept
 {
-  std::vector<std::size_t> delimiter_indices;
-  for (size_t i = 0; i < str.size(); ++i)
-    if (str[i] == '/') delimiter_indices.emplace_back(i);
-
-  if (delimiter_indices.size() != 2) throw std::runtime_error("Invalid Date format");
-
-  const std::string day_string = str.substr(0, delimiter_indices[0]);
-  const std::string month_string =
-      str.substr(delimiter_indices[0] + 1, delimiter_indices[0] + 1 - delimiter_indices[1]);
-  const std::string year_string = str.substr(delimiter_indices[1] + 1);
-
-  const auto first = std::strtoul(day_string.c_str(), nullptr, 10);
-  const auto second = std::strtoul(month_string.c_str(), nullptr, 10);
-  const auto third = std::strtoul(year_string.c_str(), nullptr, 10) - kYearOffset;
-
-  const auto& day_l = format == DDMMYYYY ? first : second;
-  const auto& month_l = format == DDMMYYYY ? second : first;
-  const auto& year_l = third;
-
-  if (!(day_l >= kMinDay && day_l <= kMaxDay)) throw std::runtime_error("Invalid day of month");
-  if (!(month_l >= kMinMonth && month_l <= kMaxMonth)) throw std::runtime_error("Invalid month of year");
-  if (year_l >= kMaxYear) throw std::runtime_error("Invalid year");
+  Date date;
+  if (Parse(str, format, date) != nullptr) return std::nullopt;
+  return date;
+}
 
-  day = day_l;
-  month = month_l;
-  year = year_l;
+const char* Date::Parse(std::string_view str, Format format, Date& date) noexcept
+{
+  std::array<unsigned, 3> fields{};
+  const char* it = str.data();
+  const char* const end = str.data() + str.size();
+  for (std::size_t i = 0; i < fields.size(); ++i)
+  {
+    if (i > 0)
+    {
+      if (it == end || *it != '/') return "Invalid Date format";
+      ++it;
+    }
+    const auto [ptr, ec] = std::from_chars(it, end, fields[i]);
+    if (ec != std::errc()) return "Invalid Date format";
+    it = ptr;
+  }
+  if (it != end) return "Invalid Date format";
+
+  const auto day_l = format == DDMMYYYY ? fields[0] : fields[1];
+  const auto month_l = format == DDMMYYYY ? fields[1] : fields[0];
+  const auto year_l = fields[2];
+  if (const char* error = Validate(day_l, month_l, year_l)) return error;
+
+  date.day = day_l;
+  date.month = month_l;
+  date.year = year_l - kYearOffset;
+  return nullptr;
 }
 
-[[nodiscard]] std::string Date::ToString(Format format) const
+std::string Date::ToString(Format format) const
 {
   if (IsZero()) throw std::runtime_error("Date is Zero");
 
-  auto first = inv::ToString(day);
-  auto second = inv::ToString(month);
-  auto third = inv::ToString(static_cast<int>(year) + Date::kYearOffset);
-
-  auto& day_s = format == DDMMYYYY ? first : second;
-  auto& month_s = format == DDMMYYYY ? second : first;
-  auto& year_s = third;
+  std::array<char, kMaxChars> buffer{};
+  const auto result = ToChars(buffer.data(), buffer.data() + buffer.size(), format);
+  return std::string(buffer.data(), result.ptr);
+}
 
-  return std::move(day_s) + '/' + std::move(month_s) + '/' + std::move(third);
+std::to_chars_result Date::ToChars(char* first, char* last, Format format) const noexcept
+{
+  if (IsZero()) return {first, std::errc::invalid_argument};
+
+  const std::array<unsigned, 3> fields{static_cast<unsigned>(format == DDMMYYYY ? day : month),
+                                       static_cast<unsigned>(format == DDMMYYYY ? month : day),
+                                       static_cast<unsigned>(year + kYearOffset)};
+  std::to_chars_result result{first, std::errc()};
+  for (std::size_t i = 0; i < fields.size(); ++i)
+  {
+    if (i > 0)
+    {
+      if (result.ptr == last) return {last, std::errc::value_too_large};
+      *result.ptr++ = '/';
+    }
+    result = std::to_chars(result.ptr, last, fields[i]);
+    if (result.ec != std::errc()) return result;
+  }
+  return result;
 }
 
 }  // namespace inv
@@ -6,55 +6,117 @@
 
 #pragma once
 
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <filesystem>
 #include <limits>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 #include "invport/detail/common.h"
 
 namespace inv
 {
-template <typename T1, typename T2>
-bool FloatingEqual(T1 a, T2 b)
+// region Numbers
+
+namespace detail
+{
+template <typename T>
+constexpr std::size_t MaxNumberChars()
 {
-  const auto difference = std::fabs(a - b);
-  return difference < std::numeric_limits<decltype(difference)>::epsilon();
+  if constexpr (std::is_floating_point_v<T>)
+    return std::numeric_limits<T>::max_digits10 + 10;  // Sign, point and exponent.
+  else if constexpr (std::is_integral_v<T>)
+    return std::numeric_limits<T>::digits10 + 2;  // Sign and a partial digit.
+  else
+    return T::kMaxChars;
 }
+}  // namespace detail
 
+/**
+ * The size of a buffer that fits any number of type T formatted by ToChars.
+ */
 template <typename T>
-std::string ToString(T num)
+constexpr std::size_t kMaxNumberChars = detail::MaxNumberChars<T>();
+
+/**
+ * Formats a number into the given buffer, without allocating and independently of the locale.
+ *
+ * Floating point numbers are formatted in the shortest fixed notation that parses back to the same number, such as
+ * "0.1" or "1500". Numbers whose fixed notation does not fit, which are only extremely large or small ones with a
+ * buffer of kMaxNumberChars, are formatted in the shortest scientific notation instead. Decimals are formatted exactly
+ * by Decimal::ToChars.
+ * @return the end of the formatted number, with std::errc::value_too_large if it does not fit
+ */
+template <typename T>
+std::to_chars_result ToChars(char* first, char* last, T num) noexcept
 {
   if constexpr (std::is_floating_point_v<T>)
   {
-    std::string str = std::to_string(num);
-    str.erase(str.find_last_not_of('0') + 1, std::string::npos);
-    if (!str.empty() && str[str.size() - 1] == '.') str.pop_back();
-    return str;
+    const auto result = std::to_chars(first, last, num, std::chars_format::fixed);
+    if (result.ec == std::errc()) return result;
+    return std::to_chars(first, last, num);
   }
   else if constexpr (std::is_integral_v<T>)
   {
-    return std::to_string(num);
+    return std::to_chars(first, last, num);
   }
+  else
+  {
+    return num.ToChars(first, last);
+  }
+}
+
+/**
+ * Formats a number like ToChars. Short numbers, such as prices, fit in the string without allocating.
+ */
+template <typename T>
+std::string ToString(T num)
+{
+  std::array<char, kMaxNumberChars<T>> buffer{};
+  const auto result = ToChars(buffer.data(), buffer.data() + buffer.size(), num);
+  return std::string(buffer.data(), result.ptr);
 }
 
+/**
+ * Parses a number from the beginning of str, without allocating and independently of the locale. Unlike strtod,
+ * leading whitespace and plus signs are not skipped. Decimals are parsed exactly by Decimal::FromChars.
+ * @param str the string to parse
+ * @param num the parsed number, which is unchanged if str does not start with a number
+ * @param base the base of integers, which is ignored for other numbers
+ * @return the end of the parsed number, with std::errc::invalid_argument if str does not start with a number, or
+ * std::errc::result_out_of_range if it does not fit in T
+ */
 template <typename T>
-T ToNum(const std::string& str, int base = 10)
+std::from_chars_result FromChars(std::string_view str, T& num, int base = 10) noexcept
 {
-  if constexpr (std::is_same_v<T, float>) return std::strtof(str.c_str(), nullptr);
-  if constexpr (std::is_same_v<T, double>) return std::strtod(str.c_str(), nullptr);
-  if constexpr (std::is_same_v<T, long double>) return std::strtold(str.c_str(), nullptr);
-
-  if constexpr (std::is_same_v<T, long>)  // NOLINT
-    return std::strtol(str.c_str(), nullptr, base);
-  if constexpr (std::is_same_v<T, long long>)  // NOLINT
-    return std::strtoll(str.c_str(), nullptr, base);
-  if constexpr (std::is_same_v<T, unsigned long>)  // NOLINT
-    return std::strtoul(str.c_str(), nullptr, base);
-  if constexpr (std::is_same_v<T, unsigned long long>)  // NOLINT
-    return std::strtoull(str.c_str(), nullptr, base);
+  if constexpr (std::is_floating_point_v<T>)
+    return std::from_chars(str.data(), str.data() + str.size(), num);
+  else if constexpr (std::is_integral_v<T>)
+    return std::from_chars(str.data(), str.data() + str.size(), num, base);
+  else
+    return T::FromChars(str, num);
 }
 
+/**
+ * Parses a number from the beginning of str like FromChars, or returns zero if it does not start with one.
+ */
+template <typename T>
+T ToNum(std::string_view str, int base = 10) noexcept
+{
+  T num = 0;
+  static_cast<void>(FromChars(str, num, base));
+  return num;
+}
+
+// endregion Numbers
+
 template <typename InputIt>
 std::string Join(InputIt begin, InputIt end, const std::string& delimiter)
 {
@@ -66,11 +128,24 @@ std::string Join(InputIt begin, InputIt end, const std::string& delimiter)
   return str;
 }
 
-std::stringstream Read(const std::filesystem::path& path);
-
-std::vector<std::string> Split(std::stringstream sstr);
+/**
+ * Splits data into lines without copying them. The views point into data, and do not include the newlines.
+ */
+std::vector<std::string_view> SplitLines(std::string_view data);
 
-inline std::vector<std::string> Split(const std::string& str) { return Split(std::stringstream(str)); }
+/**
+ * Computes the 64-bit FNV-1a hash of the given data. Unlike std::hash, the result is stable across builds and
+ * platforms, so it may be persisted.
+ */
+constexpr uint64_t Fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+  for (const char c : data)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
 
 // region Date
 
@@ -99,18 +174,42 @@ struct Date
     MMDDYYYY,
   };
 
+  /**
+   * The maximum number of characters of a formatted date, which is "dd/mm/yyyy".
+   */
+  static constexpr const std::size_t kMaxChars = 10;
+
   constexpr Date() noexcept : day(0), month(0), year(0) {}
 
   explicit Date(const json::Json& json) : Date(json.get<PrimitiveType>()) {}
 
-  explicit Date(const std::string& str, Format format = DDMMYYYY);
+  /**
+   * Parses a date of three '/'-separated numbers, such as "3/02/2020", without allocating.
+   * @param str the date, which throws std::runtime_error if it is not in the format or not a valid date
+   * @param format the order of the day and the month
+   */
+  explicit Date(std::string_view str, Format format = DDMMYYYY);
+
+  explicit Date(const std::string& str, Format format = DDMMYYYY) : Date(std::string_view(str), format) {}
 
   explicit Date(const PrimitiveType pt) { std::memcpy(this, &pt, sizeof(PrimitiveType)); }
 
-  Date(unsigned d, unsigned m, unsigned y) : Date(std::to_string(d) + '/' + std::to_string(m) + '/' + std::to_string(y))
+  /**
+   * Constructs a date from its fields, which throws std::runtime_error if they are not a valid date.
+   */
+  constexpr Date(unsigned d, unsigned m, unsigned y) : day(0), month(0), year(0)
   {
+    if (const char* error = Validate(d, m, y)) throw std::runtime_error(error);
+    day = d;
+    month = m;
+    year = y - kYearOffset;
   }
 
+  /**
+   * Parses a date like Date(std::string_view, Format), but returns an empty optional instead of throwing.
+   */
+  [[nodiscard]] static std::optional<Date> TryParse(std::string_view str, Format format = DDMMYYYY) noexcept;
+
   [[nodiscard]] PrimitiveType ToPrimitive() const
   {
     if (IsZero()) return 0;
@@ -121,6 +220,51 @@ struct Date
 
   [[nodiscard]] std::string ToString(Format format = Format::DDMMYYYY) const;
 
+  /**
+   * Formats the date into the given buffer, without leading zeros and without allocating. A buffer of kMaxChars
+   * characters always fits the date.
+   * @return the end of the formatted date, with std::errc::value_too_large if it does not fit, or
+   * std::errc::invalid_argument if the date is zero
+   */
+  std::to_chars_result ToChars(char* first, char* last, Format format = Format::DDMMYYYY) const noexcept;
+
+  /**
+   * Returns the number of days since 1/1/1970, which must not be zero. The day of month is not checked against the
+   * length of its month, so 31/2/2021 is the same day as 3/3/2021.
+   */
+  [[nodiscard]] constexpr int32_t ToDays() const noexcept
+  {
+    // Howard Hinnant's days_from_civil, whose years start in March so that leap days are at their end.
+    const int32_t d = day;
+    const int32_t m = month;
+    const int32_t y = static_cast<int32_t>(year) + kYearOffset - (m <= 2 ? 1 : 0);
+    const int32_t era = y / 400;
+    const int32_t year_of_era = y - era * 400;
+    const int32_t day_of_year = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const int32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+  }
+
+  /**
+   * Returns the date the given number of days after 1/1/1970, which throws std::runtime_error if it is out of range.
+   */
+  static constexpr Date FromDays(int32_t days)
+  {
+    if (days < 0) throw std::runtime_error("Invalid year");
+
+    // Howard Hinnant's civil_from_days.
+    const int32_t z = days + 719468;
+    const int32_t era = z / 146097;
+    const int32_t day_of_era = z - era * 146097;
+    const int32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const int32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const int32_t month_p = (5 * day_of_year + 2) / 153;
+    const int32_t d = day_of_year - (153 * month_p + 2) / 5 + 1;
+    const int32_t m = month_p < 10 ? month_p + 3 : month_p - 9;
+    const int32_t y = year_of_era + era * 400 + (m <= 2 ? 1 : 0);
+    return Date(d, m, y);
+  }
+
   [[nodiscard]] bool IsZero() const { return day == 0U || month == 0U; }
 
   static const Date& Zero() { return kZero; }
@@ -139,6 +283,14 @@ struct Date
   bool operator<=(const Date& other) const { return !(*this > other); }
   bool operator>=(const Date& other) const { return !(*this < other); }
 
+  constexpr Date& operator+=(int32_t days) { return *this = FromDays(ToDays() + days); }
+  constexpr Date& operator-=(int32_t days) { return *this = FromDays(ToDays() - days); }
+  constexpr Date& operator++() { return *this += 1; }
+  constexpr Date& operator--() { return *this -= 1; }
+  friend constexpr Date operator+(Date date, int32_t days) { return date += days; }
+  friend constexpr Date operator-(Date date, int32_t days) { return date -= days; }
+  friend constexpr int32_t operator-(const Date& lhs, const Date& rhs) noexcept { return lhs.ToDays() - rhs.ToDays(); }
+
   /**
    * Day of month: [1,31]
    */
@@ -151,6 +303,23 @@ struct Date
    * Years since 1970 [0,127]
    */
   unsigned year : kYearBitLength;
+
+ private:
+  /**
+   * Returns why the given fields are not a valid date, or null if they are.
+   */
+  static constexpr const char* Validate(unsigned d, unsigned m, unsigned y) noexcept
+  {
+    if (!(d >= kMinDay && d <= kMaxDay)) return "Invalid day of month";
+    if (!(m >= kMinMonth && m <= kMaxMonth)) return "Invalid month of year";
+    if (y < kYearOffset || y - kYearOffset >= kMaxYear) return "Invalid year";
+    return nullptr;
+  }
+
+  /**
+   * Parses the given string into date, and returns why it failed or null if it succeeded.
+   */
+  static const char* Parse(std::string_view str, Format format, Date& date) noexcept;
 };
 
 // endregion Date
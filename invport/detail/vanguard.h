@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 
+#include "invport/detail/importer.h"
 #include "invport/detail/transaction_history.h"
 
 namespace inv::vanguard
@@ -16,5 +18,28 @@ namespace fs = std::filesystem;
 
 constexpr const char* const kAccountNumberTag = "acc#";
 
-TransactionHistory Parse(const fs::path& path);
+/**
+ * Returns the importer for the schema of Vanguard exports.
+ */
+const import::Importer& GetImporter();
+
+/**
+ * Parses the transactions of a Vanguard export.
+ * @see import::Importer::Parse
+ * @param path the export to parse
+ * @param min_chunk_bytes the minimum number of bytes per thread
+ * @return a temporary history of the transactions
+ */
+TransactionHistory Parse(const fs::path& path, std::size_t min_chunk_bytes = import::kMinChunkBytes);
+
+/**
+ * Parses the transactions of a Vanguard export that have not been imported from it yet.
+ * @see import::Importer::Parse
+ * @param path the export to parse
+ * @param source what has been imported from the export, which is updated
+ * @param min_chunk_bytes the minimum number of bytes per thread
+ * @return a temporary history of the new transactions
+ */
+TransactionHistory Parse(const fs::path& path, import::Source& source,
+                         std::size_t min_chunk_bytes = import::kMinChunkBytes);
 }  // namespace inv::vanguard
@@ -0,0 +1,235 @@
+/**
+ * @file binary_format_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/binary_format.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+using Transaction = inv::TransactionPool::Transaction;
+using Timeline = inv::detail::Timeline;
+
+namespace
+{
+/**
+ * Updates the checksums of edited file contents. The 56 byte header has the checksum at offset 8 and the number of
+ * blocks at offset 16, and is followed by the block checksums.
+ */
+void Reseal(std::string& data)
+{
+  uint64_t num_blocks;
+  std::memcpy(&num_blocks, data.data() + 16, sizeof(num_blocks));
+  const auto body = std::string_view(data).substr(56 + sizeof(uint64_t) * num_blocks);
+  for (uint64_t i = 0; i < num_blocks; ++i)
+  {
+    const auto block = inv::Fnv1a(body.substr(i * inv::binary::kChecksumBlockBytes, inv::binary::kChecksumBlockBytes));
+    std::memcpy(data.data() + 56 + sizeof(uint64_t) * i, &block, sizeof(block));
+  }
+  const auto checksum = inv::Fnv1a(std::string_view(data).substr(56, sizeof(uint64_t) * num_blocks));
+  std::memcpy(data.data() + 8, &checksum, sizeof(checksum));
+}
+}  // namespace
+
+TEST(Binary, RoundTrip)
+{
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+  const auto& tr1 = inv::TransactionPool::TransactionFactory(inv::Date(1, 2, 2020), iex::Symbol("tsla"),
+                                                             Transaction::Type::BUY, 2.5, 3, 4, tags, "comment");
+  const auto& tr2 = inv::TransactionPool::TransactionFactory(inv::Date(3, 2, 2020), iex::Symbol("amd"),
+                                                             Transaction::Type::SELL, 5, 6.25, 7);
+  const auto& tr3 = inv::TransactionPool::TransactionFactory(inv::Date(1, 2, 2020), iex::Symbol("tsla"),
+                                                             Transaction::Type::SELL, 8, 9, 0, tags);
+
+  Timeline timeline;
+  timeline.Insert(tr1.date, tr1.id);
+  timeline.Insert(tr2.date, tr2.id);
+  timeline.Insert(tr3.date, tr3.id);
+
+  const auto [data, ec] = inv::binary::Encode(timeline);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_NE(inv::binary::Checksum(data), 0);
+
+  const auto [entries, decode_ec] = inv::binary::Decode(data);
+  ASSERT_EQ(decode_ec, inv::ErrorCode());
+  ASSERT_EQ(entries.size(), 3);
+
+  const std::vector<const Transaction*> expected = {&tr1, &tr3, &tr2};
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    const auto* tr = inv::TransactionPool::Find(entries[i].second);
+    ASSERT_NE(tr, nullptr);
+    EXPECT_EQ(entries[i].first, expected[i]->date.ToPrimitive());
+    EXPECT_TRUE(tr->MemberwiseEquals(*expected[i]));
+    EXPECT_EQ(tr->comment, expected[i]->comment);
+    EXPECT_EQ(static_cast<std::unordered_set<std::string>>(tr->tags),
+              static_cast<std::unordered_set<std::string>>(expected[i]->tags));
+  }
+}
+
+TEST(Binary, Invalid)
+{
+  const auto& tr = inv::TransactionPool::TransactionFactory(inv::Date(1, 2, 2020), iex::Symbol("tsla"),
+                                                            Transaction::Type::BUY, 2, 3, 4);
+  Timeline timeline;
+  timeline.Insert(tr.date, tr.id);
+
+  const auto data = inv::binary::Encode(timeline).first;
+  const auto pool_size = inv::TransactionPool::Size();
+
+  EXPECT_NE(inv::binary::Decode(std::string_view(data).substr(0, data.size() - 1)).second, inv::ErrorCode());
+  EXPECT_NE(inv::binary::Decode("INVH").second, inv::ErrorCode());
+
+  auto bad_magic = data;
+  bad_magic[0] = 'X';
+  EXPECT_NE(inv::binary::Decode(bad_magic).second, inv::ErrorCode());
+
+  auto bad_version = data;
+  bad_version[4] = 99;
+  EXPECT_NE(inv::binary::Decode(bad_version).second, inv::ErrorCode());
+
+  auto bad_checksum = data;
+  bad_checksum.back() ^= 1;
+  EXPECT_NE(inv::binary::Decode(bad_checksum).second, inv::ErrorCode());
+
+  // Failed decodes leave nothing behind in the pool.
+  EXPECT_EQ(inv::TransactionPool::Size(), pool_size);
+}
+
+TEST(Binary, ParallelDecode)
+{
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+
+  Timeline timeline;
+  std::vector<const Transaction*> expected;
+  for (int i = 0; i < 100; ++i)
+  {
+    const auto& tr = inv::TransactionPool::TransactionFactory(
+        inv::Date(1 + i % 28, 1 + i / 28, 2020), iex::Symbol(i % 2 ? "tsla" : "amd"), Transaction::Type::BUY, i, 1, 0,
+        i % 3 ? tags : Transaction::Tags(), std::to_string(i));
+    timeline.Insert(tr.date, tr.id);
+  }
+  for (const auto& [date, ids] : timeline)
+    for (const auto id : ids) expected.push_back(inv::TransactionPool::Find(id));
+
+  const auto data = inv::binary::Encode(timeline).first;
+
+  // Chunks of a single record give every hardware thread some work.
+  const auto [entries, ec] = inv::binary::Decode(data, 1);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  ASSERT_EQ(entries.size(), expected.size());
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    const auto* tr = inv::TransactionPool::Find(entries[i].second);
+    ASSERT_NE(tr, nullptr);
+    EXPECT_TRUE(tr->MemberwiseEquals(*expected[i]));
+    EXPECT_EQ(tr->comment, expected[i]->comment);
+    EXPECT_EQ(static_cast<std::unordered_set<std::string>>(tr->tags),
+              static_cast<std::unordered_set<std::string>>(expected[i]->tags));
+  }
+
+  // An error in any chunk fails the whole decode without adding anything to the pool. The header and the single
+  // block checksum take 64 bytes, and each record is 48 bytes with its date at offset 40.
+  auto out_of_order = data;
+  const auto last_date_offset = 64 + 48 * (expected.size() - 1) + 40;
+  out_of_order[last_date_offset] = 0;
+  out_of_order[last_date_offset + 1] = 0;
+  Reseal(out_of_order);
+  const auto pool_size = inv::TransactionPool::Size();
+  EXPECT_NE(inv::binary::Decode(out_of_order, 1).second, inv::ErrorCode());
+  EXPECT_EQ(inv::TransactionPool::Size(), pool_size);
+}
+
+TEST(Binary, ChecksumBlocks)
+{
+  // Enough records to span several checksum blocks.
+  Timeline timeline;
+  const auto num_records = 3 * inv::binary::kChecksumBlockBytes / 48;
+  for (std::size_t i = 0; i < num_records; ++i)
+  {
+    const auto& tr = inv::TransactionPool::TransactionFactory(inv::Date(1 + i % 28, 1, 2020), iex::Symbol("tsla"),
+                                                              Transaction::Type::BUY, 2, 3, 4);
+    timeline.Insert(tr.date, tr.id);
+  }
+
+  const auto data = inv::binary::Encode(timeline).first;
+
+  // The checksums that are carried across sections while encoding match those of the written blocks.
+  auto resealed_data = data;
+  Reseal(resealed_data);
+  EXPECT_EQ(resealed_data, data);
+
+  const auto [entries, ec] = inv::binary::Decode(data, 1);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_EQ(entries.size(), num_records);
+  for (const auto& [date, id] : entries) inv::TransactionPool::Release(id);
+  for (const auto& [date, ids] : timeline)
+    for (const auto id : ids) inv::TransactionPool::Release(id);
+
+  // A change to any block fails the decode, even though the header's checksum still matches the block checksums.
+  // The records follow the 56 byte header and four block checksums, and each starts with its price.
+  const auto pool_size = inv::TransactionPool::Size();
+  auto corrupt = data;
+  corrupt[56 + 4 * 8 + 48 * (num_records - 10)] ^= 1;
+  EXPECT_EQ(inv::binary::Checksum(corrupt), inv::binary::Checksum(data));
+  EXPECT_NE(inv::binary::Decode(corrupt, 1).second, inv::ErrorCode());
+  EXPECT_EQ(inv::TransactionPool::Size(), pool_size);
+
+  // A file whose block checksums were recomputed still decodes.
+  Reseal(corrupt);
+  const auto resealed = inv::binary::Decode(corrupt, 1).first;
+  EXPECT_EQ(resealed.size(), num_records);
+  for (const auto& [date, id] : resealed) inv::TransactionPool::Release(id);
+}
+
+TEST(Binary, SnapshotJson)
+{
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+  tags.Add("empty", "");
+  const auto& tr1 = inv::TransactionPool::TransactionFactory(inv::Date(1, 2, 2020), iex::Symbol("tsla"),
+                                                             Transaction::Type::BUY, 2.5, 3, 4, tags, "comment");
+  const auto& tr2 = inv::TransactionPool::TransactionFactory(inv::Date(3, 2, 2020), iex::Symbol("amd"),
+                                                             Transaction::Type::SELL, 5, 6.25, 7);
+
+  Timeline timeline;
+  timeline.Insert(tr1.date, tr1.id);
+  timeline.Insert(tr2.date, tr2.id);
+
+  auto [snapshot, ec] = inv::binary::Snapshot::Factory(timeline);
+  ASSERT_EQ(ec, inv::ErrorCode());
+
+  // The snapshot does not refer to the pool, so it is written the same after the transactions are released.
+  std::string expected;
+  {
+    inv::detail::JsonWriter writer(expected);
+    writer.BeginArray();
+    EXPECT_EQ(tr1.Serialize(writer), inv::ErrorCode());
+    EXPECT_EQ(tr2.Serialize(writer), inv::ErrorCode());
+    writer.EndArray();
+    ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+  }
+  inv::TransactionPool::Release(tr1.id);
+  inv::TransactionPool::Release(tr2.id);
+
+  std::string json;
+  inv::detail::JsonWriter writer(json);
+  snapshot.WriteJson(writer);
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+  EXPECT_EQ(json, expected);
+
+  std::ostringstream out;
+  const auto [checksum, write_ec] = snapshot.Write(out);
+  ASSERT_EQ(write_ec, inv::ErrorCode());
+  EXPECT_EQ(checksum, inv::binary::Checksum(out.str()));
+}
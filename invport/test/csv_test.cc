@@ -0,0 +1,45 @@
+/**
+ * @file csv_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/csv.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+TEST(Csv, SplitFields)
+{
+  std::string_view fields[4];
+  EXPECT_EQ(inv::detail::SplitFields("a,bc,,d", fields, 4), 4);
+  EXPECT_EQ(fields[0], "a");
+  EXPECT_EQ(fields[1], "bc");
+  EXPECT_EQ(fields[2], "");
+  EXPECT_EQ(fields[3], "d");
+
+  EXPECT_EQ(inv::detail::SplitFields("", fields, 4), 1);
+  EXPECT_EQ(fields[0], "");
+
+  EXPECT_EQ(inv::detail::SplitFields("a;b", fields, 4, ';'), 2);
+  EXPECT_EQ(fields[1], "b");
+}
+
+TEST(Csv, SplitLongLine)
+{
+  // Long enough to cross several 16 byte blocks, with delimiters on and around their boundaries.
+  std::string line;
+  for (int i = 0; i < 40; ++i) line += std::string(i % 17, 'x') + std::to_string(i) + ',';
+
+  std::string_view fields[41];
+  ASSERT_EQ(inv::detail::SplitFields(line, fields, 41), 41);
+  for (int i = 0; i < 40; ++i) EXPECT_EQ(fields[i], std::string(i % 17, 'x') + std::to_string(i));
+  EXPECT_EQ(fields[40], "");
+
+  // Fields past max_fields are counted, but not stored.
+  std::string_view first[2];
+  EXPECT_EQ(inv::detail::SplitFields(line, first, 2), 41);
+  EXPECT_EQ(first[1], "x1");
+}
@@ -0,0 +1,120 @@
+/**
+ * @file decimal_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/decimal.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using Cents = inv::Decimal<2>;
+using Price = inv::Decimal<4>;
+using Quantity = inv::Decimal<6>;
+
+TEST(Decimal, Double)
+{
+  EXPECT_EQ(Price(400.5).ToRaw(), 4005000);
+  EXPECT_EQ(Price(0.1).ToRaw(), 1000);
+  EXPECT_EQ(Price(-0.00006).ToRaw(), -1);
+  EXPECT_EQ(Price(0.00004).ToRaw(), 0);
+  EXPECT_EQ(Price(1e14).ToRaw(), 1000000000000000000);
+  EXPECT_DOUBLE_EQ(Price::FromRaw(4005000).ToDouble(), 400.5);
+  EXPECT_DOUBLE_EQ(static_cast<double>(Quantity(-0.000001)), -0.000001);
+
+  EXPECT_THROW(Price(1e15), std::overflow_error);
+  EXPECT_THROW(Price(std::numeric_limits<double>::quiet_NaN()), std::overflow_error);
+}
+
+TEST(Decimal, FromChars)
+{
+  const auto parse = [](std::string_view str) {
+    Price price;
+    const auto result = Price::FromChars(str, price);
+    EXPECT_EQ(result.ec, std::errc()) << str;
+    EXPECT_EQ(result.ptr, str.data() + str.size()) << str;
+    return price.ToRaw();
+  };
+
+  EXPECT_EQ(parse("400.5"), 4005000);
+  EXPECT_EQ(parse("-12"), -120000);
+  EXPECT_EQ(parse(".25"), 2500);
+  EXPECT_EQ(parse("7."), 70000);
+  EXPECT_EQ(parse("0.00004999"), 0);
+  EXPECT_EQ(parse("0.00005"), 1);
+  EXPECT_EQ(parse("-0.00005"), -1);
+  EXPECT_EQ(parse("922337203685477.5807"), std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(parse("-922337203685477.5808"), std::numeric_limits<int64_t>::min());
+
+  Price price = 3;
+  EXPECT_EQ(Price::FromChars("922337203685477.5808", price).ec, std::errc::result_out_of_range);
+  EXPECT_EQ(Price::FromChars("-", price).ec, std::errc::invalid_argument);
+  EXPECT_EQ(Price::FromChars(".", price).ec, std::errc::invalid_argument);
+  EXPECT_EQ(Price::FromChars("", price).ec, std::errc::invalid_argument);
+  EXPECT_EQ(price, 3);
+
+  const std::string_view str = "1.5e3";
+  EXPECT_EQ(Price::FromChars(str, price).ptr, str.data() + 3);
+  EXPECT_EQ(price, 1.5);
+}
+
+TEST(Decimal, ToChars)
+{
+  EXPECT_EQ(Price(400.5).ToString(), "400.5");
+  EXPECT_EQ(Price(-0.0001).ToString(), "-0.0001");
+  EXPECT_EQ(Price(12).ToString(), "12");
+  EXPECT_EQ(Price().ToString(), "0");
+  EXPECT_EQ(Price::FromRaw(std::numeric_limits<int64_t>::min()).ToString(), "-922337203685477.5808");
+  EXPECT_EQ(inv::Decimal<0>::FromRaw(-5).ToString(), "-5");
+
+  char buffer[Price::kMaxChars];
+  EXPECT_EQ(Price(400.5).ToChars(buffer, buffer + 4).ec, std::errc::value_too_large);
+  EXPECT_EQ(Price(-1).ToChars(buffer, buffer).ec, std::errc::value_too_large);
+  const auto result = Price(400.5).ToChars(buffer, buffer + 5);
+  EXPECT_EQ(result.ec, std::errc());
+  EXPECT_EQ(std::string_view(buffer, result.ptr - buffer), "400.5");
+}
+
+TEST(Decimal, Arithmetic)
+{
+  EXPECT_EQ(Price(0.1) + Price(0.2), Price(0.3));
+  EXPECT_EQ(Price(1) - Price(1.5), -Price(0.5));
+  EXPECT_LT(Price(-1), Price(0.0001));
+
+  // Products are rounded to the scale of the left operand, with ties away from zero.
+  EXPECT_EQ(Price(400.5) * Quantity(2.5), Price(1001.25));
+  EXPECT_EQ(Price(0.0001) * Quantity(0.5), Price(0.0001));
+  EXPECT_EQ(Price(-0.0001) * Quantity(0.5), Price(-0.0001));
+  EXPECT_EQ(Price(0.0001) * Quantity(0.499999), Price(0));
+  EXPECT_EQ(Cents(19.99) * Quantity(1.0 / 3), Cents(6.66));
+
+  const auto max = Price::FromRaw(std::numeric_limits<int64_t>::max());
+  const auto min = Price::FromRaw(std::numeric_limits<int64_t>::min());
+  EXPECT_THROW(max + Price(0.0001), std::overflow_error);
+  EXPECT_THROW(min - Price(0.0001), std::overflow_error);
+  EXPECT_THROW(-min, std::overflow_error);
+  EXPECT_THROW(max * Quantity(1.000001), std::overflow_error);
+  EXPECT_EQ(max * Quantity(1), max);
+}
+
+TEST(Decimal, OrderIndependentSums)
+{
+  std::vector<Price> prices;
+  for (int i = 0; i < 1000; ++i) prices.push_back(0.1 * (i % 7) + 1e6 * (i % 3));
+
+  Price forward;
+  for (const auto price : prices) forward += price;
+  Price backward;
+  for (auto it = prices.rbegin(); it != prices.rend(); ++it) backward += *it;
+  Price pairwise;
+  for (std::size_t i = 0; i < prices.size(); i += 2) pairwise += prices[i] + prices[i + 1];
+
+  EXPECT_EQ(forward, backward);
+  EXPECT_EQ(forward, pairwise);
+}
@@ -6,11 +6,17 @@
 
 #include <gtest/gtest.h>
 
+#include <condition_variable>
 #include <ctime>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "invport/detail/common.h"
 #include "invport/detail/file_serializable.h"
+#include "invport/detail/uring_backend.h"
 
 namespace file = inv::file;
 
@@ -22,7 +28,12 @@ struct FileImpl : file::FileIoBase
   }
 
   [[nodiscard]] inv::ErrorCode Write(const std::string& contents) const { return FileIoBase::WriteFile(contents); }
+  [[nodiscard]] inv::ErrorCode Stream(const std::function<inv::ErrorCode(std::ostream&)>& write) const
+  {
+    return FileIoBase::WriteFile(write);
+  }
   [[nodiscard]] inv::ValueWithErrorCode<std::string> Read() const { return FileIoBase::ReadFile(); }
+  [[nodiscard]] inv::ValueWithErrorCode<file::MappedFile> Map() const { return FileIoBase::MapFile(); }
   [[nodiscard]] inv::ErrorCode Valid() const { return FileIoBase::Validity(); }
 };
 
@@ -40,3 +51,143 @@ TEST(File, ReadWrite)
   EXPECT_EQ(read_response.first, test_text);
   EXPECT_EQ(read_response.second, inv::ErrorCode());
 }
+
+TEST(File, Map)
+{
+  std::string file_name = std::to_string(std::time(nullptr)) + "maptest";
+  FileImpl impl(file_name, file::Directory::TEMP, file::Extension::TEXT);
+  std::filesystem::remove("/tmp/invport/" + file_name + ".txt");
+
+  // A missing file maps as empty.
+  auto [missing, missing_ec] = impl.Map();
+  EXPECT_EQ(missing_ec, inv::ErrorCode());
+  EXPECT_TRUE(missing.View().empty());
+
+  std::string test_text("Testing text:\nTesting");
+  ASSERT_EQ(impl.Write(test_text), inv::ErrorCode());
+
+  const auto [mapped, ec] = impl.Map();
+  EXPECT_EQ(ec, inv::ErrorCode());
+  EXPECT_EQ(mapped.View(), test_text);
+
+  // The mapping keeps the old contents after the file is replaced.
+  ASSERT_EQ(impl.Write("Replaced"), inv::ErrorCode());
+  EXPECT_EQ(mapped.View(), test_text);
+}
+
+/**
+ * Reads the whole file at path.
+ */
+std::string Contents(const file::Path& path)
+{
+  const auto [mapped, ec] = file::MappedFile::Factory(path);
+  EXPECT_EQ(ec, inv::ErrorCode());
+  return std::string(mapped.View());
+}
+
+/**
+ * Checks the behavior that every IoBackend shares.
+ */
+void TestBackend(file::IoBackend& backend, const std::string& name)
+{
+  const file::Path path = "/tmp/invport/" + name + ".txt";
+  const file::Path target = "/tmp/invport/" + name + "_target.txt";
+  std::filesystem::create_directories("/tmp/invport");
+  std::filesystem::remove(target);
+
+  using file::IoRequest;
+  EXPECT_EQ(backend.Perform({IoRequest::Create(path),
+                             IoRequest::Write(path, "Hello, world"),
+                             IoRequest::Write(path, "there", 7),
+                             IoRequest::Append(path, "!\n"),
+                             IoRequest::Fsync(path),
+                             IoRequest::Rename(path, target)}),
+            inv::ErrorCode());
+  EXPECT_FALSE(std::filesystem::exists(path));
+  EXPECT_EQ(Contents(target), "Hello, there!\n");
+
+  // Appending to a file that already exists keeps its contents, and creating it again empties it.
+  EXPECT_EQ(backend.Perform({IoRequest::Append(target, "More\n")}), inv::ErrorCode());
+  EXPECT_EQ(Contents(target), "Hello, there!\nMore\n");
+  EXPECT_EQ(backend.Perform({IoRequest::Create(target)}), inv::ErrorCode());
+  EXPECT_EQ(Contents(target), "");
+
+  // Once a request fails, the rest of the batch is not performed.
+  EXPECT_TRUE(backend.Perform({IoRequest::Rename(path, target), IoRequest::Append(target, "Skipped")})
+                  .Failure());
+  EXPECT_EQ(Contents(target), "");
+
+  // Batches submitted without waiting all complete.
+  std::mutex mutex;
+  std::condition_variable done;
+  std::size_t completed = 0;
+  for (int i = 0; i < 100; ++i)
+  {
+    backend.Submit({IoRequest::Write(target, std::string(1, static_cast<char>('a' + i % 26)), i)},
+                   [&mutex, &done, &completed](inv::ErrorCode ec) {
+                     EXPECT_EQ(ec, inv::ErrorCode());
+                     std::lock_guard lock(mutex);
+                     ++completed;
+                     done.notify_one();
+                   });
+  }
+  {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&completed] { return completed == 100; });
+  }
+  const auto contents = Contents(target);
+  ASSERT_EQ(contents.size(), 100u);
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(contents[i], 'a' + i % 26);
+}
+
+TEST(IoBackend, Threaded)
+{
+  file::ThreadedBackend backend;
+  TestBackend(backend, "threaded_backend");
+}
+
+TEST(IoBackend, Uring)
+{
+  auto [backend, ec] = file::UringBackend::Factory();
+  if (ec.Failure()) return;  // io_uring is not available, so there is only the fallback.
+
+  TestBackend(*backend, "uring_backend");
+
+  // A batch larger than the ring fails without being performed.
+  std::vector<file::IoRequest> batch(file::UringBackend::kDefaultEntries + 1,
+                                     file::IoRequest::Append("/tmp/invport/uring_backend.txt", "x"));
+  EXPECT_TRUE(backend->Perform(std::move(batch)).Failure());
+  EXPECT_FALSE(std::filesystem::exists("/tmp/invport/uring_backend.txt"));
+}
+
+TEST(File, Stream)
+{
+  FileImpl impl("streamtest", file::Directory::TEMP, file::Extension::TEXT);
+
+  // Several chunks, with the last one partial.
+  std::string expected;
+  for (int i = 0; expected.size() < (std::size_t{9} << 19); ++i) expected += std::to_string(i) + '\n';
+
+  const auto test = [&impl, &expected] {
+    ASSERT_EQ(impl.Stream([&expected](std::ostream& out) {
+      for (std::size_t i = 0; i < expected.size(); i += 1000) out << expected.substr(i, 1000);
+      return inv::ErrorCode();
+    }),
+              inv::ErrorCode());
+    EXPECT_EQ(impl.Read().first, expected);
+
+    // A failed write leaves the file as it was.
+    EXPECT_TRUE(impl.Stream([](std::ostream& out) {
+                      out << "Partial";
+                      return inv::ErrorCode("Failed");
+                    })
+                    .Failure());
+    EXPECT_EQ(impl.Read().first, expected);
+  };
+
+  test();
+
+  file::SetIoBackend(std::make_shared<file::ThreadedBackend>());
+  test();
+  file::SetIoBackend(nullptr);
+}
@@ -0,0 +1,59 @@
+/**
+ * @file fingerprint_index_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/fingerprint_index.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using FingerprintIndex = inv::detail::FingerprintIndex;
+using Transaction = inv::detail::Transaction;
+
+namespace
+{
+const Transaction& MakeTransaction(unsigned day, const char* symbol = "tsla", double fee = 0.01)
+{
+  return inv::TransactionPool::TransactionFactory(inv::Date(day, 2, 2020), iex::Symbol(symbol),
+                                                  Transaction::Type::BUY, 400.5, 2, fee);
+}
+}  // namespace
+
+TEST(FingerprintIndex, Fingerprint)
+{
+  const auto& tr1 = MakeTransaction(1);
+  const auto& tr2 = MakeTransaction(1);
+  const auto& tr3 = MakeTransaction(1, "tsla", -0.0);
+  const auto& tr4 = MakeTransaction(1, "tsla", 0);
+  EXPECT_EQ(tr1.Fingerprint(), tr2.Fingerprint());
+  EXPECT_EQ(tr3.Fingerprint(), tr4.Fingerprint());
+  EXPECT_NE(tr1.Fingerprint(), MakeTransaction(2).Fingerprint());
+  EXPECT_NE(tr1.Fingerprint(), MakeTransaction(1, "amd").Fingerprint());
+  EXPECT_NE(tr1.Fingerprint(), tr4.Fingerprint());
+}
+
+TEST(FingerprintIndex, Missing)
+{
+  FingerprintIndex index;
+  const auto& a1 = MakeTransaction(1);
+  const auto& a2 = MakeTransaction(1);
+  const auto& b = MakeTransaction(2);
+  index.Insert(a1);
+  index.Insert(a2);
+  index.Insert(b);
+
+  // Three duplicates of a, of which the index has two, and one of b.
+  const std::vector<FingerprintIndex::ID> ids = {MakeTransaction(1).id, MakeTransaction(2).id, MakeTransaction(1).id,
+                                                 MakeTransaction(1).id, MakeTransaction(3).id};
+  EXPECT_EQ(index.Missing(ids), std::vector<FingerprintIndex::ID>({ids[3], ids[4]}));
+
+  // Transactions in the index are their own duplicates.
+  EXPECT_TRUE(index.Missing({a1.id, b.id}).empty());
+
+  index.Erase(a1);
+  index.Erase(b);
+  EXPECT_EQ(index.Missing(ids), std::vector<FingerprintIndex::ID>({ids[1], ids[2], ids[3], ids[4]}));
+}
@@ -0,0 +1,64 @@
+/**
+ * @file flush_thread_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/flush_thread.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+using FlushThread = inv::detail::FlushThread;
+
+TEST(FlushThread, Order)
+{
+  std::vector<int> writes;
+  FlushThread thread(std::chrono::milliseconds(0));
+  for (int i = 0; i < 100; ++i) thread.Submit([&writes, i] { writes.push_back(i); });
+  thread.Wait();
+
+  ASSERT_EQ(writes.size(), 100);
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(writes[i], i);
+}
+
+TEST(FlushThread, Coalesce)
+{
+  // The window is long enough that nothing is written unless the thread is waited on.
+  std::vector<int> writes;
+  FlushThread thread(std::chrono::hours(1));
+  thread.Submit([&writes] { writes.push_back(1); });
+  thread.Submit([&writes] { writes.push_back(2); });
+  thread.Submit([&writes] { writes.push_back(3); });
+  EXPECT_TRUE(writes.empty());
+
+  thread.Wait();
+  EXPECT_EQ(writes, std::vector<int>({1, 2, 3}));
+}
+
+TEST(FlushThread, Shutdown)
+{
+  std::vector<int> writes;
+  {
+    FlushThread thread(std::chrono::hours(1));
+    thread.Submit([&writes] { writes.push_back(1); });
+  }
+
+  // Destruction writes the queue without waiting for the window.
+  EXPECT_EQ(writes, std::vector<int>({1}));
+}
+
+TEST(FlushThread, StartsOnFirstSubmit)
+{
+  int writes = 0;
+  FlushThread thread(std::chrono::milliseconds(0));
+  thread.Wait();
+  EXPECT_FALSE(thread.Started());
+
+  thread.Submit([&writes] { ++writes; });
+  EXPECT_TRUE(thread.Started());
+  thread.Wait();
+  EXPECT_EQ(writes, 1);
+}
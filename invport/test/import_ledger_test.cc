@@ -0,0 +1,101 @@
+/**
+ * @file import_ledger_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/import_ledger.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+using Ledger = inv::import::Ledger;
+
+TEST(Ledger, Flush)
+{
+  inv::import::Schema schema;
+  schema.name = "Test";
+  const auto relative_path = std::to_string(std::rand()) + "import_ledger";
+  std::filesystem::remove("/tmp/invport/" + relative_path + ".json");
+  {
+    Ledger ledger(relative_path, inv::file::Directory::TEMP);
+    ASSERT_TRUE(ledger.LedgerValidity().Success());
+    EXPECT_EQ(ledger.Find(schema, "/tmp/export.csv", 1).imported_size, 0);
+
+    auto& source = ledger.Find(schema, "/tmp/export.csv", 1);
+    source.imported_hash = 0xfedcba9876543210ULL;
+    source.imported_size = 1234;
+    source.rows = {{1, 2}, {0xffffffffffffffffULL, 1}};
+    ASSERT_TRUE(ledger.Flush().Success());
+  }
+
+  Ledger ledger(relative_path, inv::file::Directory::TEMP);
+  ASSERT_TRUE(ledger.LedgerValidity().Success());
+
+  // Paths are compared once they are absolute and normal.
+  const auto& source = ledger.Find(schema, "/tmp/../tmp/export.csv", 1);
+  EXPECT_EQ(source.imported_hash, 0xfedcba9876543210ULL);
+  EXPECT_EQ(source.imported_size, 1234);
+  EXPECT_EQ(source.rows, (std::unordered_map<uint64_t, uint32_t>{{1, 2}, {0xffffffffffffffffULL, 1}}));
+
+  schema.name = "Other";
+  EXPECT_TRUE(ledger.Find(schema, "/tmp/export.csv", 1).rows.empty());
+}
+
+TEST(Ledger, PrepareFlush)
+{
+  inv::import::Schema schema;
+  schema.name = "Test";
+  const auto relative_path = std::to_string(std::rand()) + "import_ledger";
+  std::filesystem::remove("/tmp/invport/" + relative_path + ".json");
+  std::function<inv::ErrorCode()> write;
+  {
+    Ledger ledger(relative_path, inv::file::Directory::TEMP);
+    ledger.Find(schema, "/tmp/export.csv", 1).rows = {{1, 2}};
+    write = ledger.PrepareFlush();
+
+    // The write holds the ledger as it was when it was prepared, and outlives it.
+    ledger.Find(schema, "/tmp/export.csv", 1).rows = {{3, 4}};
+  }
+  ASSERT_TRUE(write().Success());
+
+  Ledger ledger(relative_path, inv::file::Directory::TEMP);
+  ASSERT_TRUE(ledger.LedgerValidity().Success());
+  EXPECT_EQ(ledger.Find(schema, "/tmp/export.csv", 1).rows, (std::unordered_map<uint64_t, uint32_t>{{1, 2}}));
+}
+
+TEST(Ledger, InvalidFingerprint)
+{
+  const auto relative_path = std::to_string(std::rand()) + "import_ledger";
+  std::filesystem::create_directories("/tmp/invport");
+  std::ofstream("/tmp/invport/" + relative_path + ".json") << R"({"Test:/tmp/export.csv":{"rows":{"12x":1}}})";
+
+  const Ledger ledger(relative_path, inv::file::Directory::TEMP);
+  EXPECT_TRUE(ledger.LedgerValidity().Failure());
+}
+
+TEST(Ledger, History)
+{
+  inv::import::Schema schema;
+  schema.name = "Test";
+  const auto relative_path = std::to_string(std::rand()) + "import_ledger";
+  std::filesystem::remove("/tmp/invport/" + relative_path + ".json");
+  {
+    Ledger ledger(relative_path, inv::file::Directory::TEMP);
+    ledger.Find(schema, "/tmp/export.csv", 1).rows = {{1, 2}};
+    ASSERT_TRUE(ledger.Flush().Success());
+  }
+
+  // Rows imported into another history, such as one that was replaced since, are forgotten.
+  Ledger ledger(relative_path, inv::file::Directory::TEMP);
+  ASSERT_TRUE(ledger.LedgerValidity().Success());
+  EXPECT_EQ(ledger.Find(schema, "/tmp/export.csv", 1).rows, (std::unordered_map<uint64_t, uint32_t>{{1, 2}}));
+  EXPECT_TRUE(ledger.Find(schema, "/tmp/export.csv", 2).rows.empty());
+  EXPECT_TRUE(ledger.Find(schema, "/tmp/export.csv", 1).rows.empty());
+}
@@ -0,0 +1,230 @@
+/**
+ * @file importer_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/importer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+using Importer = inv::import::Importer;
+using Schema = inv::import::Schema;
+using Transaction = inv::TransactionHistory::Transaction;
+
+namespace
+{
+/**
+ * A headerless export, in date order, with unsigned quantities and a preamble and disclaimer around the transactions.
+ */
+Schema IndexSchema()
+{
+  Schema schema;
+  schema.name = "Index";
+  schema.delimiter = ';';
+  schema.date = 0;
+  schema.type = 1;
+  schema.symbol = 2;
+  schema.quantity = 3;
+  schema.price = 4;
+  schema.date_format = inv::Date::Format::DDMMYYYY;
+  schema.types = {{"B", Transaction::Type::BUY}, {"S", Transaction::Type::SELL}};
+  return schema;
+}
+
+/**
+ * An export with a header, whose columns are in a different order than Vanguard's.
+ */
+Schema HeaderSchema()
+{
+  Schema schema;
+  schema.name = "Header";
+  schema.symbol = "Symbol";
+  schema.date = "Date";
+  schema.type = "Action";
+  schema.quantity = "Quantity";
+  schema.price = "Price";
+  schema.fee = "Fees";
+  schema.account = "Account";
+  schema.account_tag = "account";
+  schema.types = {{"Buy", Transaction::Type::BUY}, {"Sell", Transaction::Type::SELL}};
+  return schema;
+}
+}  // namespace
+
+TEST(Importer, Index)
+{
+  std::string data = "Exported 1/1/2021;\n\n";
+  for (int i = 1; i <= 100; ++i) data += std::to_string(i % 28 + 1) + "/2/2020;B;TSLA;2;400.5\r\n";
+  data += "1/3/2020;Dividend;VMFXX;0;1\n";
+  data += "2/3/2020;S;TSLA;50;700.5\n";
+  data += "This is not investment advice\n";
+  data += "3/3/2020;B;TSLA;1000;1\n";
+
+  const Importer importer(IndexSchema());
+  for (std::size_t min_chunk_bytes : {1, 16, 1024, 1 << 20})
+  {
+    const auto th = importer.ParseContents(data, min_chunk_bytes);
+    EXPECT_EQ(th.GetTotals().at(inv::Symbol("TSLA")).quantity, 150);
+    EXPECT_TRUE(th[inv::Date(1, 3, 2020)].empty());
+    EXPECT_TRUE(th[inv::Date(3, 3, 2020)].empty());
+
+    const auto sells = th[inv::Date(2, 3, 2020)];
+    ASSERT_EQ(sells.size(), 1);
+    const auto* sell = inv::TransactionPool::Find(*sells.begin());
+    EXPECT_EQ(sell->type, Transaction::Type::SELL);
+    EXPECT_EQ(sell->quantity, 50);
+    EXPECT_EQ(sell->price, 700.5);
+    EXPECT_EQ(sell->fee, 0);
+  }
+}
+
+TEST(Importer, Windows)
+{
+  // Rows of the same date are added in file order, or from the end of the file if they are newest first.
+  std::string rows;
+  for (int i = 0; i < 200; ++i)
+    rows += std::to_string(i % 3 + 1) + "/2/2020;" + (i % 5 ? "B" : "S") + ";TSLA;" + std::to_string(i) + ";1\n";
+  const std::string data = "Exported 1/1/2021;\n" + rows + "This is not investment advice\n3/3/2020;B;TSLA;1;1\n";
+
+  for (const bool newest_first : {false, true})
+  {
+    auto schema = IndexSchema();
+    schema.newest_first = newest_first;
+    const Importer importer(schema);
+
+    inv::TransactionHistory expected(inv::TransactionHistory::kTempTag);
+    for (int n = 0; n < 200; ++n)
+    {
+      const int i = newest_first ? 199 - n : n;
+      expected.Add(inv::Date(i % 3 + 1, 2, 2020), inv::Symbol("TSLA"),
+                   i % 5 ? Transaction::Type::BUY : Transaction::Type::SELL, 1, i, 0);
+    }
+
+    // Small chunks split the rows across many windows, and the end of the transactions is in a later window.
+    for (std::size_t min_chunk_bytes : {1, 7, 64, 1 << 20})
+      EXPECT_TRUE(importer.ParseContents(data, min_chunk_bytes).MemberwiseEquals(expected)) << min_chunk_bytes;
+  }
+}
+
+TEST(Importer, Header)
+{
+  const std::string data =
+      "Symbol,Date,Account,Quantity\n"
+      "TSLA,01/02/2020,1,4\n"
+      "\n"
+      "Symbol,Account,Date,Action,Price,Quantity,Fees\n"
+      "TSLA,1,01/02/2020,Buy,400.5,4,0\n"
+      "AAPL,2,01/03/2020,Buy,300,1,0.5\n"
+      "TSLA,1,02/03/2020,Sell,700.5,1,0.01\n";
+
+  const auto th = Importer(HeaderSchema()).ParseContents(data);
+  const auto totals = th.GetTotals();
+  ASSERT_EQ(totals.size(), 2);
+  EXPECT_EQ(totals.at(inv::Symbol("TSLA")).quantity, 3);
+  EXPECT_EQ(totals.at(inv::Symbol("AAPL")).quantity, 1);
+  EXPECT_EQ(th.GetAssociatedTransactions("account", "1").size(), 2);
+  EXPECT_EQ(th.GetAssociatedTransactions("account", "2").size(), 1);
+}
+
+TEST(Importer, MissingHeader)
+{
+  const auto th = Importer(HeaderSchema()).ParseContents("Symbol,Date,Account,Quantity\nTSLA,01/02/2020,1,4\n");
+  EXPECT_TRUE(th.GetTotals().empty());
+}
+
+TEST(Importer, InvalidRow)
+{
+  // The last row has the shape of a transaction, but its date does not exist.
+  const std::string data = "1/2/2020;B;TSLA;2;400.5\n45/13/2020;B;TSLA;2;400.5\n";
+  const Importer importer(IndexSchema());
+  inv::import::Source source;
+
+  const auto pool_size = inv::TransactionPool::Size();
+  EXPECT_TRUE(importer.ParseContents(data).GetTotals().empty());
+  EXPECT_TRUE(importer.ParseContents(data, source).GetTotals().empty());
+  EXPECT_EQ(inv::TransactionPool::Size(), pool_size);
+  EXPECT_EQ(source.imported_size, 0);
+  EXPECT_TRUE(source.rows.empty());
+}
+
+TEST(Importer, InvalidSchema)
+{
+  auto schema = IndexSchema();
+  schema.price = {};
+  EXPECT_THROW(Importer{schema}, std::invalid_argument);
+
+  schema = IndexSchema();
+  schema.types.clear();
+  EXPECT_THROW(Importer{schema}, std::invalid_argument);
+
+  schema = IndexSchema();
+  schema.account = 5;
+  EXPECT_THROW(Importer{schema}, std::invalid_argument);
+
+  schema = IndexSchema();
+  schema.num_fields = 3;
+  EXPECT_THROW(Importer{schema}, std::invalid_argument);
+
+  schema = IndexSchema();
+  schema.numeric_accounts = true;
+  EXPECT_THROW(Importer{schema}, std::invalid_argument);
+}
+
+TEST(Importer, Incremental)
+{
+  const std::string rows = "1/2/2020;B;TSLA;2;400.5\n2/2/2020;B;TSLA;2;400.5\n";
+  const std::string disclaimer = "This is not investment advice\n";
+  const Importer importer(IndexSchema());
+  inv::import::Source source;
+
+  const auto th1 = importer.ParseContents(rows + disclaimer, source);
+  EXPECT_EQ(th1.GetTotals().at(inv::Symbol("TSLA")).quantity, 4);
+  EXPECT_EQ(source.imported_size, rows.size());
+
+  // Nothing is new.
+  const auto th2 = importer.ParseContents(rows + disclaimer, source);
+  EXPECT_TRUE(th2.GetTotals().empty());
+
+  // The new rows follow the imported ones, and one of them is identical to an imported row.
+  const std::string new_rows = "2/2/2020;B;TSLA;2;400.5\n3/2/2020;S;TSLA;1;700.5\n";
+  const auto th3 = importer.ParseContents(rows + new_rows + disclaimer, source);
+  EXPECT_EQ(th3.GetTotals().at(inv::Symbol("TSLA")).quantity, 1);
+  EXPECT_EQ(th3[inv::Date(2, 2, 2020)].size(), 1);
+  EXPECT_EQ(source.imported_size, rows.size() + new_rows.size());
+  EXPECT_EQ(source.rows.size(), 3);
+}
+
+TEST(Importer, IncrementalNewestFirst)
+{
+  auto schema = HeaderSchema();
+  schema.newest_first = true;
+  const Importer importer(schema);
+  inv::import::Source source;
+
+  const std::string header = "Symbol,Account,Date,Action,Price,Quantity,Fees\n";
+  const std::string jan = "TSLA,1,01/02/2020,Buy,400.5,4,0\n";
+  const std::string feb = "TSLA,1,02/03/2020,Sell,700.5,1,0.01\n";
+  const std::string mar = "AAPL,2,03/03/2020,Buy,300,1,0.5\n";
+
+  const auto th1 = importer.ParseContents("Holdings changed\n" + header + feb + jan, source);
+  EXPECT_EQ(th1.GetTotals().at(inv::Symbol("TSLA")).quantity, 3);
+
+  // The new row is above the imported ones, and the text above the section changed.
+  const auto th2 = importer.ParseContents("Holdings changed again\n" + header + mar + feb + jan, source);
+  ASSERT_EQ(th2.GetTotals().size(), 1);
+  EXPECT_EQ(th2.GetTotals().at(inv::Symbol("AAPL")).quantity, 1);
+  EXPECT_EQ(source.imported_size, mar.size() + feb.size() + jan.size());
+
+  // The oldest row fell out of the export, so the imported bytes are gone and rows are matched by fingerprint.
+  const std::string apr = "AAPL,2,01/04/2020,Buy,300,2,0.5\n";
+  const auto th3 = importer.ParseContents(header + apr + mar + feb, source);
+  ASSERT_EQ(th3.GetTotals().size(), 1);
+  EXPECT_EQ(th3.GetTotals().at(inv::Symbol("AAPL")).quantity, 2);
+  EXPECT_EQ(source.imported_size, apr.size() + mar.size() + feb.size());
+  EXPECT_EQ(source.rows.size(), 4);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file journal_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/journal.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "invport/detail/utils.h"
+
+using Journal = inv::detail::Journal;
+
+namespace
+{
+std::string ReadJournal(const std::string& name)
+{
+  std::ifstream in("/tmp/invport/" + name + ".jsonl");
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+}  // namespace
+
+TEST(Journal, AppendLoad)
+{
+  const auto name = std::to_string(std::rand()) + "journal";
+  const auto base_hash = inv::Fnv1a("base");
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+
+  Journal journal(name, inv::file::Directory::TEMP);
+  auto [records, ec] = journal.Load(base_hash);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_TRUE(records.empty());
+
+  ASSERT_EQ(journal.Append({{Journal::ADD, {{"a", 1}}}, {Journal::REMOVE, {{"b", 2}}}}), inv::ErrorCode());
+  ASSERT_EQ(journal.Append({{Journal::ADD, {{"c", 3}}}}), inv::ErrorCode());
+  EXPECT_EQ(journal.Size(), 3);
+
+  Journal reloaded(name, inv::file::Directory::TEMP);
+  std::tie(records, ec) = reloaded.Load(base_hash);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  ASSERT_EQ(records.size(), 3);
+  EXPECT_EQ(records[1].operation, Journal::REMOVE);
+  EXPECT_EQ(records[1].transaction["b"], 2);
+  EXPECT_EQ(reloaded.Size(), 3);
+
+  // Records of a different base file are stale.
+  std::tie(records, ec) = reloaded.Load(inv::Fnv1a("other"));
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_TRUE(records.empty());
+  EXPECT_EQ(reloaded.Size(), 0);
+}
+
+TEST(Journal, Id)
+{
+  const auto name = std::to_string(std::rand()) + "journal";
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+
+  Journal journal(name, inv::file::Directory::TEMP);
+  EXPECT_EQ(journal.Id(), 0);
+  ASSERT_EQ(journal.Load(inv::Fnv1a("base")).second, inv::ErrorCode());
+  const auto id = journal.Id();
+  EXPECT_NE(id, 0);
+
+  // The ID is kept when the base file is rewritten.
+  ASSERT_EQ(journal.Reset(inv::Fnv1a("rewritten")), inv::ErrorCode());
+  Journal reloaded(name, inv::file::Directory::TEMP);
+  ASSERT_EQ(reloaded.Load(inv::Fnv1a("rewritten")).second, inv::ErrorCode());
+  EXPECT_EQ(reloaded.Id(), id);
+
+  // A base file that was replaced behind the journal's back gets a new ID.
+  ASSERT_EQ(reloaded.Load(inv::Fnv1a("replaced")).second, inv::ErrorCode());
+  EXPECT_NE(reloaded.Id(), id);
+}
+
+TEST(Journal, TornRecord)
+{
+  const auto name = std::to_string(std::rand()) + "journal";
+  const auto base_hash = inv::Fnv1a("base");
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+
+  Journal journal(name, inv::file::Directory::TEMP);
+  ASSERT_EQ(journal.Reset(base_hash), inv::ErrorCode());
+  ASSERT_EQ(journal.Append({{Journal::ADD, {{"a", 1}}}}), inv::ErrorCode());
+  {
+    std::ofstream out("/tmp/invport/" + name + ".jsonl", std::ios_base::app);
+    out << R"({"operation":0,"transa)";
+  }
+
+  auto [records, ec] = journal.Load(base_hash);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_EQ(records.size(), 1);
+
+  // The torn record is truncated, so later appends stay readable.
+  ASSERT_EQ(journal.Append({{Journal::ADD, {{"b", 2}}}}), inv::ErrorCode());
+  std::tie(records, ec) = journal.Load(base_hash);
+  ASSERT_EQ(ec, inv::ErrorCode());
+  EXPECT_EQ(records.size(), 2);
+  EXPECT_EQ(ReadJournal(name).back(), '\n');
+}
@@ -0,0 +1,107 @@
+/**
+ * @file json_reader_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/json_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+using JsonReader = inv::detail::JsonReader;
+
+namespace
+{
+/**
+ * Returns the message of the exception thrown by f, or an empty string if nothing was thrown.
+ */
+template <typename F>
+std::string ErrorOf(F f)
+{
+  try
+  {
+    f();
+  }
+  catch (const std::runtime_error& e)
+  {
+    return e.what();
+  }
+  return {};
+}
+}  // namespace
+
+TEST(JsonReader, Document)
+{
+  JsonReader reader(R"( {"a": [1, -2.5e3, true, null], "skipped": {"x": [{}, "y"]}, "b": "text"} )");
+  reader.BeginObject();
+
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.Key(), "a");
+  EXPECT_EQ(reader.Peek(), JsonReader::BEGIN_ARRAY);
+  reader.BeginArray();
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.Number<int>(), 1);
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.Number<double>(), -2500);
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_TRUE(reader.Boolean());
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_TRUE(reader.SkipNull());
+  EXPECT_FALSE(reader.HasNext());
+  reader.EndArray();
+
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.Key(), "skipped");
+  reader.Skip();
+
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.Key(), "b");
+  EXPECT_EQ(reader.String(), "text");
+  EXPECT_FALSE(reader.HasNext());
+  reader.EndObject();
+
+  reader.Finish();
+  EXPECT_EQ(reader.Peek(), JsonReader::END);
+}
+
+TEST(JsonReader, Escapes)
+{
+  JsonReader reader(R"(["q\"b\\s\/n\nt\t", "\u00e9\ud83d\ude00"])");
+  reader.BeginArray();
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.String(), "q\"b\\s/n\nt\t");
+  ASSERT_TRUE(reader.HasNext());
+  EXPECT_EQ(reader.String(), "\xC3\xA9\xF0\x9F\x98\x80");
+  reader.EndArray();
+}
+
+TEST(JsonReader, Errors)
+{
+  // Errors report the byte offset at which they occurred.
+  EXPECT_NE(ErrorOf([] {
+              JsonReader reader("[1, 2,]");
+              reader.BeginArray();
+              while (reader.HasNext()) reader.Skip();
+            }).find("\"6\""),
+            std::string::npos);
+
+  EXPECT_NE(ErrorOf([] { JsonReader("[01]").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader("\"unterminated").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader("\"bad \\x escape\"").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader("\"\\ud800\"").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader("{\"a\" 1}").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader("tru").Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { JsonReader(std::string(1000, '[')).Skip(); }), "");
+  EXPECT_NE(ErrorOf([] { static_cast<void>(JsonReader("1.5").Number<int>()); }), "");
+  EXPECT_NE(ErrorOf([] { static_cast<void>(JsonReader("-1").Number<unsigned>()); }), "");
+  EXPECT_NE(ErrorOf([] {
+              JsonReader reader("{} {}");
+              reader.Skip();
+              reader.Finish();
+            }),
+            "");
+  EXPECT_EQ(ErrorOf([] { JsonReader("[[], {}, \"\", 0, false]").Skip(); }), "");
+}
@@ -0,0 +1,74 @@
+/**
+ * @file json_writer_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/json_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+using JsonWriter = inv::detail::JsonWriter;
+
+TEST(JsonWriter, Nesting)
+{
+  std::ostringstream out;
+  JsonWriter writer(out);
+  writer.BeginArray();
+  writer.BeginObject().Key("a").Number(1).Key("b").BeginArray().EndArray().Key("c").BeginObject().EndObject();
+  writer.EndObject();
+  writer.Number(2.5).String("x");
+  writer.EndArray();
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+
+  EXPECT_EQ(out.str(), R"([{"a":1,"b":[],"c":{}},2.5,"x"])");
+  EXPECT_EQ(writer.Hash(), inv::Fnv1a(out.str()));
+}
+
+TEST(JsonWriter, Escaping)
+{
+  const std::string str = "quote\" backslash\\ newline\n tab\t bell\x07 unicodeé";
+
+  std::ostringstream out;
+  JsonWriter writer(out);
+  writer.String(str);
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+
+  EXPECT_EQ(out.str(), "\"quote\\\" backslash\\\\ newline\\n tab\\t bell\\u0007 unicodeé\"");
+  EXPECT_EQ(inv::json::Json::parse(out.str()).get<std::string>(), str);
+}
+
+TEST(JsonWriter, Numbers)
+{
+  const double values[] = {0.1, 1e300, -3, 1.0 / 3, 123456789.125};
+
+  std::ostringstream out;
+  JsonWriter writer(out, 4);
+  writer.BeginArray();
+  for (const auto value : values) writer.Number(value);
+  writer.Number(std::numeric_limits<double>::infinity());
+  writer.Number(uint64_t(18446744073709551615ULL));
+  writer.EndArray();
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+
+  // Doubles round trip exactly, even with a buffer smaller than a single number.
+  const auto json = inv::json::Json::parse(out.str());
+  for (std::size_t i = 0; i < std::size(values); ++i) EXPECT_EQ(json[i].get<double>(), values[i]);
+  EXPECT_TRUE(json[std::size(values)].is_null());
+  EXPECT_EQ(json[std::size(values) + 1].get<uint64_t>(), 18446744073709551615ULL);
+}
+
+TEST(JsonWriter, StringSink)
+{
+  std::string out = "prefix";
+  JsonWriter writer(out, 4);
+  writer.BeginArray().String("abcdef").Number(12345).EndArray();
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+
+  EXPECT_EQ(out, R"(prefix["abcdef",12345])");
+  EXPECT_EQ(writer.Hash(), inv::Fnv1a(R"(["abcdef",12345])"));
+}
@@ -164,6 +164,27 @@ TEST(Key, FilePopulated)
   }
 }
 
+TEST(Key, FileMissingKey)
+{
+  // The keys are valid, but the last one is missing, so none of them are loaded.
+  inv::json::Json json;
+  json[kKeyNameMap[0]] = "pk_483bb0e8c5dd4a2974d362dd8aad154d";
+  json[kKeyNameMap[1]] = "sk_12d3caa449bd4de4b9f063089c47f69b";
+  json[kKeyNameMap[2]] = "Tpk_fb19c49530a6f1e9158142010a80043c";
+
+  fs::create_directory("/tmp/invport");
+  std::ofstream ofstream("/tmp/invport/keychain.json");
+  ofstream << json.dump();
+  ofstream.close();
+
+  const Keychain key(inv::file::TEMP);
+  ASSERT_TRUE(key.KeychainValidity().Failure());
+  EXPECT_FALSE(key.Populated());
+  EXPECT_TRUE(key.Get(Keychain::KeyType::PUBLIC).second.Failure());
+
+  fs::remove("/tmp/invport/keychain.json");
+}
+
 TEST(Key, ValidKeys)
 {
   Keychain key(inv::file::TEMP);
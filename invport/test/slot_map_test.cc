@@ -0,0 +1,110 @@
+/**
+ * @file slot_map_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/slot_map.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_set>
+
+using SlotMap = inv::detail::SlotMap<std::string, 2>;
+
+TEST(SlotMap, EmplaceFind)
+{
+  SlotMap map;
+  std::vector<SlotMap::Handle> handles;
+  for (int i = 0; i < 10; ++i)
+  {
+    map.Emplace([&](SlotMap::Handle h) {
+      handles.push_back(h);
+      return std::string("v");
+    });
+  }
+  EXPECT_EQ(map.Size(), 10);
+
+  std::unordered_set<SlotMap::Handle> unique(handles.begin(), handles.end());
+  EXPECT_EQ(unique.size(), handles.size());
+
+  for (const auto& handle : handles)
+  {
+    const auto* ptr = map.Find(handle);
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(*ptr, "v");
+  }
+}
+
+TEST(SlotMap, ReferencesAreStable)
+{
+  SlotMap map;
+  SlotMap::Handle first_handle;
+  const auto& first = map.Emplace([&](SlotMap::Handle h) {
+    first_handle = h;
+    return std::to_string(h);
+  });
+
+  for (int i = 0; i < 100; ++i) map.Emplace([](SlotMap::Handle h) { return std::to_string(h); });
+
+  EXPECT_EQ(&first, map.Find(first_handle));
+  EXPECT_EQ(first, std::to_string(first_handle));
+}
+
+TEST(SlotMap, StaleHandle)
+{
+  SlotMap map;
+  SlotMap::Handle old_handle;
+  map.Emplace([&](SlotMap::Handle h) {
+    old_handle = h;
+    return std::string("old");
+  });
+
+  EXPECT_TRUE(map.Erase(old_handle));
+  EXPECT_FALSE(map.Erase(old_handle));
+  EXPECT_EQ(map.Find(old_handle), nullptr);
+  EXPECT_TRUE(map.Empty());
+
+  // The freed slot is reused under a new generation.
+  SlotMap::Handle new_handle;
+  map.Emplace([&](SlotMap::Handle h) {
+    new_handle = h;
+    return std::string("new");
+  });
+
+  EXPECT_EQ(SlotMap::GetIndex(new_handle), SlotMap::GetIndex(old_handle));
+  EXPECT_NE(new_handle, old_handle);
+  EXPECT_EQ(map.Find(old_handle), nullptr);
+  ASSERT_TRUE(map.Find(new_handle));
+  EXPECT_EQ(*map.Find(new_handle), "new");
+}
+
+TEST(SlotMap, Reserve)
+{
+  SlotMap map;
+  const auto handles = map.Reserve(10);
+  EXPECT_EQ(map.Size(), 10);
+  EXPECT_EQ(std::unordered_set<SlotMap::Handle>(handles.begin(), handles.end()).size(), handles.size());
+
+  // Reserved slots are not found until they are constructed, which can happen in any order.
+  for (std::size_t i = handles.size(); i-- > 1;)
+  {
+    EXPECT_EQ(map.Find(handles[i]), nullptr);
+    map.EmplaceAt(handles[i], [](SlotMap::Handle h) { return std::to_string(h); });
+    ASSERT_TRUE(map.Find(handles[i]));
+    EXPECT_EQ(*map.Find(handles[i]), std::to_string(handles[i]));
+  }
+
+  // Unreserving recycles a slot whether or not it was constructed.
+  map.Unreserve(handles[0]);
+  map.Unreserve(handles[1]);
+  EXPECT_EQ(map.Size(), 8);
+  EXPECT_EQ(map.Find(handles[1]), nullptr);
+
+  const auto reused = map.Reserve(2);
+  EXPECT_EQ(SlotMap::GetIndex(reused[0]), SlotMap::GetIndex(handles[1]));
+  EXPECT_EQ(SlotMap::GetIndex(reused[1]), SlotMap::GetIndex(handles[0]));
+  EXPECT_NE(reused[0], handles[1]);
+  EXPECT_EQ(map.Size(), 10);
+}
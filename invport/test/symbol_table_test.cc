@@ -0,0 +1,52 @@
+/**
+ * @file symbol_table_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/symbol_table.h"
+
+#include <gtest/gtest.h>
+
+#include "invport/detail/dictionary.h"
+
+using Dictionary = inv::detail::Dictionary;
+using SymbolTable = inv::SymbolTable;
+using InternedSymbol = inv::InternedSymbol;
+
+TEST(Dictionary, Intern)
+{
+  Dictionary dict{"reserved"};
+  EXPECT_EQ(dict.Find("reserved"), 0);
+  EXPECT_FALSE(dict.Find("a").has_value());
+
+  const auto a = dict.Intern("a");
+  const auto b = dict.Intern("b");
+  EXPECT_EQ(a, 1);
+  EXPECT_EQ(b, 2);
+  EXPECT_EQ(dict.Intern("a"), a);
+  EXPECT_EQ(dict.Size(), 3);
+
+  EXPECT_EQ(dict.Get(a), "a");
+  EXPECT_EQ(dict.Get(b), "b");
+  EXPECT_EQ(dict.Find("b"), b);
+}
+
+TEST(SymbolTable, InternedSymbol)
+{
+  const InternedSymbol empty;
+  EXPECT_EQ(empty.Id(), SymbolTable::kEmptySymbolID);
+  EXPECT_EQ(empty.Get(), "");
+
+  const InternedSymbol tsla1(inv::Symbol("tsla"));
+  const InternedSymbol tsla2(inv::Symbol("tsla"));
+  const InternedSymbol aapl(inv::Symbol("aapl"));
+  EXPECT_EQ(tsla1, tsla2);
+  EXPECT_NE(tsla1, aapl);
+  EXPECT_EQ(tsla1.Get(), "tsla");
+  EXPECT_EQ(SymbolTable::Find(inv::Symbol("tsla")), tsla1.Id());
+  EXPECT_LT(tsla1.Id(), SymbolTable::Size());
+
+  const InternedSymbol from_json(inv::json::Json("aapl"));
+  EXPECT_EQ(from_json, aapl);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file timeline_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/timeline.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using Timeline = inv::detail::Timeline;
+using Date = inv::Date;
+
+namespace
+{
+std::vector<std::pair<Date, std::vector<Timeline::TransactionID>>> Flatten(const Timeline& timeline)
+{
+  std::vector<std::pair<Date, std::vector<Timeline::TransactionID>>> v;
+  for (const auto& [date, ids] : timeline)
+    v.emplace_back(date, std::vector<Timeline::TransactionID>(ids.begin(), ids.end()));
+  return v;
+}
+}  // namespace
+
+TEST(Timeline, InsertOrder)
+{
+  const Date d1(1, 1, 2020), d2(2, 1, 2020), d3(3, 1, 2020);
+
+  Timeline timeline;
+  EXPECT_TRUE(timeline.Insert(d2, 1));
+  EXPECT_TRUE(timeline.Insert(d1, 2));
+  EXPECT_TRUE(timeline.Insert(d3, 3));
+  EXPECT_TRUE(timeline.Insert(d2, 4));
+  EXPECT_FALSE(timeline.Insert(d2, 1));
+  EXPECT_EQ(timeline.size(), 4);
+
+  using Expected = decltype(Flatten(timeline));
+  EXPECT_EQ(Flatten(timeline), (Expected{{d1, {2}}, {d2, {1, 4}}, {d3, {3}}}));
+
+  EXPECT_EQ(timeline.find(d2)->second.size(), 2);
+  EXPECT_EQ(timeline.find(Date(4, 1, 2020)), timeline.end());
+  EXPECT_EQ(timeline.lower_bound(Date(1, 6, 2019))->first, d1);
+  EXPECT_EQ(timeline.upper_bound(d2)->first, d3);
+  EXPECT_TRUE(timeline.at(Date(4, 1, 2020)).empty());
+}
+
+TEST(Timeline, Erase)
+{
+  const Date d1(1, 1, 2020), d2(2, 1, 2020), d3(3, 1, 2020);
+
+  Timeline timeline;
+  timeline.Insert(d1, 1);
+  timeline.Insert(d2, 2);
+  timeline.Insert(d2, 3);
+  timeline.Insert(d3, 4);
+
+  auto [iter, emptied] = timeline.Erase(d2, 2);
+  EXPECT_FALSE(emptied);
+  EXPECT_EQ(iter->first, d2);
+  EXPECT_EQ(iter->second.size(), 1);
+
+  std::tie(iter, emptied) = timeline.Erase(d2, 3);
+  EXPECT_TRUE(emptied);
+  EXPECT_EQ(iter->first, d3);
+
+  std::tie(iter, emptied) = timeline.Erase(d2, 3);
+  EXPECT_FALSE(emptied);
+  EXPECT_EQ(iter, timeline.end());
+  EXPECT_EQ(timeline.size(), 2);
+}
+
+TEST(Timeline, BulkInsert)
+{
+  const Date d1(1, 1, 2020), d2(2, 1, 2020), d3(3, 1, 2020);
+
+  Timeline timeline;
+  timeline.Insert(d1, 1);
+  timeline.Insert(d3, 2);
+  timeline.Insert({{d1.ToPrimitive(), 3}, {d1.ToPrimitive(), 1}, {d2.ToPrimitive(), 4}, {d3.ToPrimitive(), 5}});
+
+  using Expected = decltype(Flatten(timeline));
+  EXPECT_EQ(Flatten(timeline), (Expected{{d1, {1, 3}}, {d2, {4}}, {d3, {2, 5}}}));
+
+  Timeline other;
+  other.Insert(d3, 5);
+  other.Insert(d1, 3);
+  other.Insert(d3, 2);
+  other.Insert(d1, 1);
+  other.Insert(d2, 4);
+  EXPECT_EQ(timeline, other);
+}
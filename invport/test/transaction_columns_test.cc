@@ -0,0 +1,123 @@
+/**
+ * @file transaction_columns_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/transaction_columns.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "invport/detail/transaction_history.h"
+
+using TransactionHistory = inv::TransactionHistory;
+using TransactionColumns = inv::TransactionColumns;
+using Transaction = TransactionHistory::Transaction;
+
+namespace
+{
+const auto ts1 = inv::Date(14, 7, 2015);
+const auto ts2 = inv::Date(6, 8, 2015);
+const auto ts3 = inv::Date(2, 12, 2017);
+const auto ts4 = inv::Date(30, 1, 2018);
+
+TransactionHistory MakeHistory()
+{
+  TransactionHistory th(TransactionHistory::kTempTag);
+  th.Add(ts3, iex::Symbol("tsla"), Transaction::Type::SELL, 1, 1, 19);
+  th.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  th.Add(ts2, iex::Symbol("aapl"), Transaction::Type::BUY, 5, 6, 7);
+  th.Add(ts4, iex::Symbol("tsla"), Transaction::Type::SELL, 1, 2, 19);
+  th.Add(ts2, iex::Symbol("amd"), Transaction::Type::BUY, 8, 9, 10);
+  return th;
+}
+}  // namespace
+
+TEST(TransactionColumns, SortedByDate)
+{
+  const auto th = MakeHistory();
+  const TransactionColumns columns(th);
+
+  ASSERT_EQ(columns.Size(), 5);
+  EXPECT_TRUE(std::is_sorted(columns.Dates().begin(), columns.Dates().end()));
+
+  for (TransactionColumns::Row r = 0; r < columns.Size(); ++r)
+  {
+    const auto* tr = inv::TransactionPool::Find(columns.Ids()[r]);
+    ASSERT_TRUE(tr);
+    EXPECT_EQ(columns.Dates()[r], tr->date.ToPrimitive());
+    EXPECT_EQ(columns.Symbols()[r], tr->symbol.Id());
+    EXPECT_EQ(columns.Prices()[r], tr->price);
+  }
+}
+
+TEST(TransactionColumns, GetTotals)
+{
+  const auto th = MakeHistory();
+  const TransactionColumns columns(th);
+
+  for (const auto& [start, end] : {std::pair{inv::Date(), inv::Date()}, {ts2, ts3}, {ts3, inv::Date()}})
+  {
+    const auto expected = th.GetTotals(start, end);
+    const auto totals = columns.GetTotals(start, end);
+    for (const auto& [symbol, t] : expected)
+    {
+      const auto id = inv::SymbolTable::Find(symbol);
+      ASSERT_TRUE(id.has_value());
+      EXPECT_EQ(totals[*id].spent, t.spent);
+      EXPECT_EQ(totals[*id].quantity, t.quantity);
+      EXPECT_EQ(totals[*id].fees, t.fees);
+    }
+  }
+}
+
+TEST(TransactionColumns, ParallelTotals)
+{
+  TransactionHistory th(TransactionHistory::kTempTag);
+  for (int i = 0; i < 1000; ++i)
+  {
+    th.Add(inv::Date(1 + i % 28, 1 + i % 12, 2000 + i % 20), iex::Symbol(i % 3 ? "tsla" : "amd"),
+           i % 4 ? Transaction::Type::BUY : Transaction::Type::SELL, 0.1 * (i % 7) + 1000 * (i % 5), 0.001 * i, 0.01);
+  }
+  const TransactionColumns columns(th);
+
+  // Chunks of a single row give every hardware thread some work, and the sums do not depend on how rows are split.
+  const auto expected = columns.GetTotals({}, {}, columns.Size());
+  for (std::size_t min_chunk_rows : {1, 7, 100})
+  {
+    const auto totals = columns.GetTotals({}, {}, min_chunk_rows);
+    ASSERT_EQ(totals.size(), expected.size());
+    for (std::size_t i = 0; i < totals.size(); ++i)
+    {
+      EXPECT_EQ(totals[i].spent, expected[i].spent);
+      EXPECT_EQ(totals[i].quantity, expected[i].quantity);
+      EXPECT_EQ(totals[i].fees, expected[i].fees);
+    }
+  }
+
+  const auto tsla = th.GetTotals().at(iex::Symbol("tsla"));
+  EXPECT_EQ(expected[*inv::SymbolTable::Find(iex::Symbol("tsla"))].spent, tsla.spent);
+}
+
+TEST(TransactionColumns, ValuationAndSelect)
+{
+  const auto th = MakeHistory();
+  const TransactionColumns columns(th);
+
+  std::vector<inv::Price> prices(columns.NumSymbols(), 0);
+  prices[*inv::SymbolTable::Find(iex::Symbol("tsla"))] = 10;
+  prices[*inv::SymbolTable::Find(iex::Symbol("amd"))] = 2;
+
+  EXPECT_EQ(columns.GetValuation(prices), 0 * 10 + 9 * 2);
+  EXPECT_EQ(columns.GetValuation(prices, ts3), 2 * 10 + 9 * 2);
+
+  TransactionColumns::Filter filter;
+  filter.symbol = inv::SymbolTable::Find(iex::Symbol("tsla"));
+  filter.type = Transaction::Type::SELL;
+  EXPECT_EQ(columns.Select(filter).size(), 2);
+
+  filter.end_date = ts3;
+  EXPECT_EQ(columns.Select(filter).size(), 1);
+}
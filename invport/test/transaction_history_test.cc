@@ -8,7 +8,17 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
 #include "invport/detail/common.h"
+#include "invport/detail/import_ledger.h"
 #include "invport/detail/transaction.h"
 
 using TransactionHistory = inv::TransactionHistory;
@@ -106,4 +116,452 @@ TEST(TransactionHistory, GetQuantities)
   EXPECT_EQ(totals_map[iex::Symbol("amd")].fees, 10);
   EXPECT_EQ(totals_map[iex::Symbol("brk.a")].fees, 13);
   EXPECT_EQ(totals_map[iex::Symbol("mj")].fees, 16);
-}
\ No newline at end of file
+}
+
+TEST(TransactionHistory, GetAssociatedTransactions)
+{
+  const auto ts1 = inv::Date(14, 7, 2015);
+  const auto ts2 = inv::Date(6, 8, 2015);
+
+  Transaction::Tags acc1;
+  acc1.Add("acc#", "1");
+  Transaction::Tags acc2 = {"tag1"};
+  acc2.Add("acc#", "2");
+
+  TransactionHistory th(TransactionHistory::kTempTag);
+  const auto id1 = th.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4, acc1);
+  const auto id2 = th.Add(ts2, iex::Symbol("aapl"), Transaction::Type::BUY, 5, 6, 7, acc2);
+  const auto id3 = th.Add(ts2, iex::Symbol("amd"), Transaction::Type::BUY, 8, 9, 10, acc1);
+  th.Add(ts2, iex::Symbol("mj"), Transaction::Type::BUY, 8, 9, 10);
+
+  EXPECT_EQ(th.GetAssociatedTransactions("acc#"), (TransactionHistory::TransactionSet{id1, id2, id3}));
+  EXPECT_EQ(th.GetAssociatedTransactions("acc#", "1"), (TransactionHistory::TransactionSet{id1, id3}));
+  EXPECT_EQ(th.GetAssociatedTransactions("acc#", "2"), (TransactionHistory::TransactionSet{id2}));
+  EXPECT_TRUE(th.GetAssociatedTransactions("acc#", "3").empty());
+  EXPECT_TRUE(th.GetAssociatedTransactions("missing").empty());
+
+  th.Remove(id1);
+  EXPECT_EQ(th.GetAssociatedTransactions("acc#", "1"), (TransactionHistory::TransactionSet{id3}));
+
+  const auto all = th.GetAssociatedTransactions();
+  EXPECT_EQ(all.size(), 2);
+  EXPECT_EQ(all.at("tag1"), (TransactionHistory::TransactionSet{id2}));
+  EXPECT_EQ(all.at("acc#"), (TransactionHistory::TransactionSet{id2, id3}));
+
+  TransactionHistory merged(TransactionHistory::kTempTag);
+  merged.Merge(th);
+  EXPECT_EQ(merged.GetAssociatedTransactions("acc#"), (TransactionHistory::TransactionSet{id2, id3}));
+}
+
+TEST(TransactionHistory, GetTotalsWindows)
+{
+  TransactionHistory th(TransactionHistory::kTempTag);
+  const std::vector<iex::Symbol> symbols = {iex::Symbol("tsla"), iex::Symbol("aapl"), iex::Symbol("amd")};
+
+  std::vector<TransactionHistory::TransactionID> ids;
+  for (int i = 0; i < 200; ++i)
+  {
+    const auto date = inv::Date(1 + (i * 7) % 28, 1 + (i * 5) % 12, 2000 + (i % 4));
+    const auto type = i % 3 == 0 ? Transaction::Type::SELL : Transaction::Type::BUY;
+    ids.push_back(th.Add(date, symbols[i % symbols.size()], type, i % 10, 1 + i % 7, i % 2));
+  }
+
+  // Remove some transactions, including ones that empty their date.
+  for (std::size_t i = 0; i < ids.size(); i += 9) th.Remove(ids[i]);
+
+  const auto brute_force = [&th](const inv::Date& start, const inv::Date& end) {
+    iex::SymbolMap<Transaction::Totals> map;
+    for (const auto& [date, trs] : th)
+    {
+      if ((!start.IsZero() && date < start) || (!end.IsZero() && date > end)) continue;
+      for (const auto& id : trs)
+      {
+        const auto* tr = inv::TransactionPool::Find(id);
+        map[tr->symbol] += Transaction::Totals(*tr);
+      }
+    }
+    return map;
+  };
+
+  const std::vector<inv::Date> bounds = {inv::Date(),         inv::Date(1, 1, 2000),  inv::Date(15, 6, 2000),
+                                         inv::Date(3, 3, 2001), inv::Date(28, 12, 2002), inv::Date(1, 1, 2010)};
+  for (const auto& start : bounds)
+  {
+    for (const auto& end : bounds)
+    {
+      const auto expected = brute_force(start, end);
+      const auto totals = th.GetTotals(start, end);
+      ASSERT_EQ(totals.size(), expected.size());
+      for (const auto& [symbol, t] : expected)
+      {
+        ASSERT_TRUE(totals.count(symbol));
+        EXPECT_EQ(totals.at(symbol).spent, t.spent);
+        EXPECT_EQ(totals.at(symbol).quantity, t.quantity);
+        EXPECT_EQ(totals.at(symbol).fees, t.fees);
+      }
+    }
+  }
+}
+
+TEST(TransactionHistory, GetTotalsAsOf)
+{
+  TransactionHistory th(TransactionHistory::kTempTag);
+  const auto tsla = iex::Symbol("tsla");
+
+  // Enough distinct dates to span several checkpoints.
+  std::vector<inv::Date> dates;
+  std::vector<TransactionHistory::TransactionID> ids;
+  for (int i = 0; i < 500; ++i)
+  {
+    dates.emplace_back(1 + i % 28, 1 + (i / 28) % 12, 2000 + i / (28 * 12));
+    ids.push_back(th.Add(dates.back(), tsla, Transaction::Type::BUY, 1, 1, 0));
+  }
+
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, dates[0]).quantity, 1);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, dates[299]).quantity, 300);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, inv::Date()).quantity, 500);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, inv::Date(1, 1, 1999)).quantity, 0);
+  EXPECT_TRUE(th.GetTotalsAsOf(inv::Date(1, 1, 1999)).empty());
+
+  // Edits invalidate only later checkpoints, and later queries see them.
+  th.Remove(ids[10]);
+  th.Add(dates[400], tsla, Transaction::Type::SELL, 1, 5, 0);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, dates[5]).quantity, 6);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, dates[299]).quantity, 299);
+  EXPECT_EQ(th.GetTotalsAsOf(tsla, dates[400]).quantity, 401 - 1 - 5);
+  EXPECT_EQ(th.GetTotalsAsOf(dates[499])[tsla].quantity, 500 - 1 - 5);
+  EXPECT_EQ(th.GetTotals({}, dates[299])[tsla].quantity, 299);
+}
+
+TEST(TransactionHistory, MergeInterleaved)
+{
+  const std::vector<iex::Symbol> symbols = {iex::Symbol("tsla"), iex::Symbol("aapl"), iex::Symbol("amd")};
+  const auto date = [](int k) { return inv::Date(1 + k % 28, 1 + (k / 28) % 12, 1971 + k / (28 * 12)); };
+
+  // Every imported date falls between two existing ones, the worst case for inserting dates one at a time.
+  TransactionHistory th(TransactionHistory::kTempTag);
+  for (int k = 1; k < 20000; k += 2) th.Add(date(k), symbols[k % 3], Transaction::Type::BUY, 1, 1, 0);
+
+  TransactionHistory import(TransactionHistory::kTempTag);
+  for (int k = 0; k < 20000; k += 2)
+  {
+    for (int i = 0; i < 3; ++i) import.Add(date(k), symbols[i], Transaction::Type::BUY, 1, 1 + i, 0);
+  }
+
+  EXPECT_TRUE(th.MergeMissing(import).empty());
+  EXPECT_EQ(th.GetTotals().at(symbols[0]).quantity, 3333 + 10000);
+  EXPECT_EQ(th.GetTotals().at(symbols[1]).quantity, 3334 + 20000);
+  EXPECT_EQ(th.GetTotals(date(0), date(99)).at(symbols[2]).quantity, 50 * 3 + 16);
+  EXPECT_EQ(th.GetTotalsAsOf(symbols[2], date(9999)).quantity, 5000 * 3 + 1666);
+}
+
+TEST(TransactionHistory, FlushJournal)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto base_path = "/tmp/invport/" + name + ".json";
+  std::filesystem::remove(base_path);
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+  const Transaction::Tags tags = {"tag1", "acc#=123"};
+
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  const auto id1 = th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4, tags, "1");
+  th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4, tags, "2");
+  th.Add(inv::Date(3, 2, 2020), iex::Symbol("amd"), Transaction::Type::SELL, 5, 6, 7);
+  th.Flush();
+
+  // Small edits are appended to the journal without writing the base file.
+  EXPECT_FALSE(std::filesystem::exists(base_path));
+
+  const auto id4 = th.Add(inv::Date(4, 2, 2020), iex::Symbol("mj"), Transaction::Type::BUY, 8, 9, 10);
+  th.Remove(id1);
+  th.Remove(id4);
+  th.Flush();
+  th.Sync();
+
+  auto reloaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(reloaded.MemberwiseEquals(th));
+  EXPECT_NE(th.Identity(), 0);
+  EXPECT_EQ(reloaded.Identity(), th.Identity());
+  ASSERT_EQ(reloaded[inv::Date(1, 2, 2020)].size(), 1);
+  EXPECT_EQ(inv::TransactionPool::Find(*reloaded[inv::Date(1, 2, 2020)].begin())->comment, "2");
+
+  // Enough edits compact the journal into the base file.
+  for (int i = 0; i < 2000; ++i)
+    th.Add(inv::Date(1 + i % 28, 3, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 1, 1, 0);
+  th.Flush();
+  th.Sync();
+  EXPECT_TRUE(std::filesystem::exists(base_path));
+
+  const auto compacted = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(compacted.MemberwiseEquals(th));
+  EXPECT_EQ(compacted.Identity(), th.Identity());
+
+  // A base file that is replaced behind the history's back makes it a different history.
+  std::ofstream(base_path) << "[]";
+  const auto replaced = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_NE(replaced.Identity(), th.Identity());
+}
+
+TEST(TransactionHistory, BinaryFormat)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+  std::filesystem::remove("/tmp/invport/" + name + ".bin");
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::BINARY);
+  for (int i = 0; i < 2000; ++i)
+    th.Add(inv::Date(1 + i % 28, 1 + i % 12, 2020), iex::Symbol(i % 2 ? "tsla" : "amd"), Transaction::Type::BUY, i, 1,
+           0, tags, std::to_string(i));
+  th.Flush();
+  th.Sync();
+  EXPECT_TRUE(std::filesystem::exists("/tmp/invport/" + name + ".bin"));
+
+  // Edits after compaction are journaled on top of the binary file.
+  th.Add(inv::Date(1, 1, 2021), iex::Symbol("mj"), Transaction::Type::SELL, 1, 2, 3);
+  th.Flush();
+  th.Sync();
+
+  const auto reloaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::BINARY);
+  EXPECT_TRUE(reloaded.MemberwiseEquals(th));
+  EXPECT_EQ(reloaded.GetAssociatedTransactions("acc#", "123").size(), 2000);
+}
+
+TEST(TransactionHistory, FlushInBackground)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto journal_path = "/tmp/invport/" + name + ".jsonl";
+  std::filesystem::remove("/tmp/invport/" + name + ".json");
+  std::filesystem::remove(journal_path);
+
+  // The window is long enough that nothing is written until the history is synced.
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::JSON, std::chrono::hours(1));
+  const auto journal_size = std::filesystem::file_size(journal_path);
+  for (int i = 0; i < 10; ++i)
+  {
+    th.Add(inv::Date(1 + i, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+    th.Flush();
+  }
+  EXPECT_EQ(std::filesystem::file_size(journal_path), journal_size);
+
+  th.Sync();
+  EXPECT_GT(std::filesystem::file_size(journal_path), journal_size);
+
+  const auto reloaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(reloaded.MemberwiseEquals(th));
+}
+
+/**
+ * Counts the appends to one file, and performs every request on a ThreadedBackend.
+ */
+class CountingBackend : public inv::file::IoBackend
+{
+ public:
+  explicit CountingBackend(inv::file::Path path) : path_(std::move(path)) {}
+
+  void Submit(std::vector<inv::file::IoRequest> batch, Callback on_complete) override
+  {
+    for (const auto& request : batch)
+    {
+      if (request.type == inv::file::IoRequest::APPEND && request.path == path_) ++appends;
+    }
+    backend_.Submit(std::move(batch), std::move(on_complete));
+  }
+
+  std::atomic<int> appends{0};
+
+ private:
+  const inv::file::Path path_;
+  inv::file::ThreadedBackend backend_;
+};
+
+TEST(TransactionHistory, FlushMergesAppends)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto journal_path = "/tmp/invport/" + name + ".jsonl";
+  std::filesystem::remove("/tmp/invport/" + name + ".json");
+  std::filesystem::remove(journal_path);
+
+  const auto backend = std::make_shared<CountingBackend>(journal_path);
+  inv::file::SetIoBackend(backend);
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::JSON, std::chrono::hours(1));
+
+  // Every flush within the window is appended in one write.
+  for (int i = 0; i < 10; ++i)
+  {
+    th.Add(inv::Date(1 + i, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+    th.Flush();
+  }
+  th.Sync();
+  EXPECT_EQ(backend->appends, 1);
+
+  th.Add(inv::Date(1, 3, 2020), iex::Symbol("tsla"), Transaction::Type::SELL, 2, 3, 4);
+  th.Flush();
+  th.Sync();
+  EXPECT_EQ(backend->appends, 2);
+  inv::file::SetIoBackend(nullptr);
+
+  const auto reloaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(reloaded.MemberwiseEquals(th));
+}
+
+TEST(TransactionHistory, AfterFlush)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto journal_path = "/tmp/invport/" + name + ".jsonl";
+  std::filesystem::remove("/tmp/invport/" + name + ".json");
+  std::filesystem::remove(journal_path);
+
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::JSON, std::chrono::hours(1));
+  const auto journal_size = std::filesystem::file_size(journal_path);
+  th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  th.Flush();
+
+  // The write runs after the flush, on the flush thread.
+  std::uintmax_t seen_size = 0;
+  th.AfterFlush([&seen_size, &journal_path] {
+    seen_size = std::filesystem::file_size(journal_path);
+    return inv::ErrorCode();
+  });
+  EXPECT_EQ(seen_size, 0);
+
+  th.Sync();
+  EXPECT_GT(seen_size, journal_size);
+}
+
+TEST(TransactionHistory, CompactAfterImport)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto ledger_name = name + "_ledger";
+  std::filesystem::remove("/tmp/invport/" + name + ".json");
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+  std::filesystem::remove("/tmp/invport/" + ledger_name + ".json");
+
+  inv::import::Schema schema;
+  schema.name = "Test";
+  auto th = TransactionHistory::Factory(name, inv::file::Directory::TEMP, inv::file::JSON, std::chrono::hours(1));
+  {
+    // An import flushes its rows, then queues the ledger behind them.
+    inv::import::Ledger ledger(ledger_name, inv::file::Directory::TEMP);
+    th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+    th.Flush();
+    ledger.Find(schema, "/tmp/export.csv", th.Identity()).rows = {{1, 2}};
+    th.AfterFlush(ledger.PrepareFlush());
+  }
+
+  // Enough edits to rewrite the history are flushed before the flush thread gets to the ledger.
+  for (int i = 0; i < 1100; ++i)
+  {
+    th.Add(inv::Date(1 + i % 28, 1 + i / 28 % 12, 2020 + i / 336), iex::Symbol("amd"), Transaction::Type::BUY, 1, 1, 0);
+  }
+  th.Flush();
+  th.Sync();
+
+  inv::import::Ledger ledger(ledger_name, inv::file::Directory::TEMP);
+  ASSERT_TRUE(ledger.LedgerValidity().Success());
+  EXPECT_EQ(ledger.Find(schema, "/tmp/export.csv", th.Identity()).rows,
+            (std::unordered_map<uint64_t, uint32_t>{{1, 2}}));
+
+  const auto reloaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(reloaded.MemberwiseEquals(th));
+}
+
+TEST(TransactionHistory, SerializeStreaming)
+{
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+
+  TransactionHistory th(TransactionHistory::kTempTag);
+  th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 0.1, 3, 4, tags, "a \"quoted\" comment");
+  th.Add(inv::Date(1, 2, 2020), iex::Symbol("amd"), Transaction::Type::SELL, 5, 1.0 / 3, 0);
+  th.Add(inv::Date(3, 2, 2019), iex::Symbol("mj"), Transaction::Type::BUY, 8, 9, 10, Transaction::Tags(), "\n");
+
+  std::ostringstream out;
+  inv::detail::JsonWriter writer(out);
+  ASSERT_EQ(th.Serialize(writer), inv::ErrorCode());
+  ASSERT_EQ(writer.Flush(), inv::ErrorCode());
+
+  TransactionHistory th2(TransactionHistory::kTempTag);
+  ASSERT_EQ(th2.Deserialize(inv::json::Json::parse(out.str())), inv::ErrorCode());
+  EXPECT_TRUE(th2.MemberwiseEquals(th));
+  EXPECT_EQ(th2.GetAssociatedTransactions("acc#", "123").size(), 1);
+
+  const auto streamed = inv::json::Json::parse(out.str());
+  const auto dom = th.Serialize().first;
+  ASSERT_EQ(streamed.size(), dom.size());
+  for (std::size_t i = 0; i < dom.size(); ++i)
+  {
+    EXPECT_EQ(streamed[i]["comment"], dom[i]["comment"]);
+    EXPECT_EQ(streamed[i]["price"].get<double>(), dom[i]["price"].get<double>());
+    EXPECT_EQ(streamed[i]["quantity"].get<double>(), dom[i]["quantity"].get<double>());
+  }
+}
+
+TEST(TransactionHistory, FactoryStreaming)
+{
+  const auto name = std::to_string(std::rand()) + "th";
+  const auto path = "/tmp/invport/" + name + ".json";
+  std::filesystem::remove("/tmp/invport/" + name + ".jsonl");
+
+  Transaction::Tags tags = {"tag1"};
+  tags.Add("acc#", "123");
+
+  TransactionHistory th(TransactionHistory::kTempTag);
+  th.Add(inv::Date(1, 2, 2020), iex::Symbol("tsla"), Transaction::Type::BUY, 0.1, 3, 4, tags, "a \"quoted\" comment");
+  th.Add(inv::Date(3, 2, 2019), iex::Symbol("mj"), Transaction::Type::SELL, 8, 9, 10);
+  {
+    std::ofstream out(path);
+    out << th.Serialize().first.dump(2);
+  }
+
+  const auto loaded = TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+  EXPECT_TRUE(loaded.MemberwiseEquals(th));
+  EXPECT_EQ(loaded.GetAssociatedTransactions("acc#", "123").size(), 1);
+
+  // Malformed files fail with the offset of the error.
+  {
+    std::ofstream out(path);
+    out << R"([{"date": 1, "symbol": "tsla", "type": 0, "price": 1, "quantity": 1, "fee": 0}, {"date": 1,)";
+  }
+  try
+  {
+    TransactionHistory::Factory(name, inv::file::Directory::TEMP);
+    FAIL();
+  }
+  catch (const std::runtime_error& e)
+  {
+    EXPECT_NE(std::string(e.what()).find("\"91\""), std::string::npos) << e.what();
+  }
+}
+
+TEST(TransactionHistory, MergeMissing)
+{
+  const auto ts1 = inv::Date(14, 7, 2015);
+  const auto ts2 = inv::Date(6, 8, 2015);
+
+  TransactionHistory th(TransactionHistory::kTempTag);
+  th.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  th.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  th.Add(ts2, iex::Symbol("aapl"), Transaction::Type::SELL, 5, 6, 7);
+
+  // The import overlaps the history, and has a third duplicate of the first transaction.
+  TransactionHistory import(TransactionHistory::kTempTag);
+  import.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  import.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  import.Add(ts1, iex::Symbol("tsla"), Transaction::Type::BUY, 2, 3, 4);
+  import.Add(ts2, iex::Symbol("aapl"), Transaction::Type::SELL, 5, 6, 7);
+  import.Add(ts2, iex::Symbol("amd"), Transaction::Type::BUY, 8, 9, 10);
+
+  const auto skipped = th.MergeMissing(import);
+  EXPECT_EQ(skipped.size(), 3);
+  EXPECT_EQ(th[ts1].size(), 3);
+  EXPECT_EQ(th[ts2].size(), 2);
+  EXPECT_EQ(th.GetTotals().at(iex::Symbol("tsla")).quantity, 9);
+
+  // Removed transactions are no longer duplicates.
+  th.Remove(*th[ts2].begin());
+  th.Remove(*th[ts2].begin());
+  EXPECT_EQ(th.MergeMissing(import).size(), 3);
+  EXPECT_EQ(th[ts2].size(), 2);
+}
@@ -67,3 +67,48 @@ TEST(Transaction, Find)
     }
   }
 }
+
+TEST(Transaction, Release)
+{
+  const auto [json, ec] = tr1.Serialize();
+  ASSERT_EQ(ec, iex::ErrorCode());
+
+  const auto id = TransactionPool::TransactionFactory(json).id;
+  ASSERT_TRUE(TransactionPool::Find(id));
+
+  EXPECT_TRUE(TransactionPool::Release(id));
+  EXPECT_FALSE(TransactionPool::Find(id));
+  EXPECT_FALSE(TransactionPool::Release(id));
+
+  // The new transaction may reuse the released storage, but never the released ID.
+  const auto new_id = TransactionPool::TransactionFactory(json).id;
+  EXPECT_NE(id, new_id);
+  EXPECT_FALSE(TransactionPool::Find(id));
+  EXPECT_TRUE(TransactionPool::Find(new_id));
+}
+
+TEST(Transaction, Tags)
+{
+  Transaction::Tags tags = {"tag1", "tag2"};
+  tags.Add("acc#", "12345");
+  tags.Add("tag1", "ignored");
+  EXPECT_EQ(tags.Size(), 3);
+  EXPECT_TRUE(tags.Contains("tag1"));
+  EXPECT_TRUE(tags.Contains("acc#"));
+  EXPECT_FALSE(tags.Contains("12345"));
+
+  // Spill past the inline capacity.
+  tags.Add("tag3");
+  tags.Add("tag4");
+  EXPECT_EQ(tags.Size(), 5);
+
+  const Transaction::Tags copy = tags;
+  const std::unordered_set<std::string> expected = {"tag1", "tag2", "acc#=12345", "tag3", "tag4"};
+  EXPECT_EQ(static_cast<std::unordered_set<std::string>>(copy), expected);
+
+  Transaction::Tags from_json;
+  from_json = static_cast<inv::json::Json>(tags);
+  EXPECT_EQ(static_cast<std::unordered_set<std::string>>(from_json), expected);
+  EXPECT_TRUE(from_json.Contains("acc#"));
+  EXPECT_EQ(from_json.Keys(), (std::unordered_set<std::string>{"tag1", "tag2", "acc#", "tag3", "tag4"}));
+}
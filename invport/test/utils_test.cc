@@ -8,8 +8,62 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
 using Date = inv::Date;
 
+TEST(Utils, SplitLines)
+{
+  const std::string data = "a,b\n\nc\nd";
+  const auto lines = inv::SplitLines(data);
+  ASSERT_EQ(lines.size(), 4);
+  EXPECT_EQ(lines[0], "a,b");
+  EXPECT_EQ(lines[1], "");
+  EXPECT_EQ(lines[2], "c");
+  EXPECT_EQ(lines[3], "d");
+
+  // The lines are views into the data, not copies.
+  EXPECT_EQ(lines[0].data(), data.data());
+  EXPECT_EQ(inv::SplitLines("a\n").size(), 1);
+  EXPECT_TRUE(inv::SplitLines("").empty());
+}
+
+TEST(Utils, ToString)
+{
+  EXPECT_EQ(inv::ToString(0.1), "0.1");
+  EXPECT_EQ(inv::ToString(1500.0), "1500");
+  EXPECT_EQ(inv::ToString(-2.5F), "-2.5");
+  EXPECT_EQ(inv::ToString(1e-7), "0.0000001");
+  EXPECT_EQ(inv::ToString(1e300), "1e+300");
+  EXPECT_EQ(inv::ToString(-42), "-42");
+  EXPECT_EQ(inv::ToString(std::numeric_limits<int64_t>::min()), "-9223372036854775808");
+  EXPECT_EQ(inv::ToString(std::numeric_limits<uint64_t>::max()), "18446744073709551615");
+
+  for (const double num : {0.1 + 0.2, 1.0 / 3, 400.5, -1e-300, std::numeric_limits<double>::max()})
+    EXPECT_EQ(inv::ToNum<double>(inv::ToString(num)), num);
+}
+
+TEST(Utils, ToNum)
+{
+  EXPECT_DOUBLE_EQ(inv::ToNum<double>("400.5"), 400.5);
+  EXPECT_DOUBLE_EQ(inv::ToNum<double>("-2.5;B"), -2.5);
+  EXPECT_DOUBLE_EQ(inv::ToNum<double>(""), 0);
+  EXPECT_DOUBLE_EQ(inv::ToNum<double>("x"), 0);
+  EXPECT_EQ(inv::ToNum<long>("-17"), -17);
+  EXPECT_EQ(inv::ToNum<unsigned>("ff", 16), 255);
+
+  int num = 3;
+  EXPECT_EQ(inv::FromChars("99999999999", num).ec, std::errc::result_out_of_range);
+  const std::string_view str = "12/2020";
+  const auto result = inv::FromChars(str, num);
+  EXPECT_EQ(result.ec, std::errc());
+  EXPECT_EQ(result.ptr, str.data() + 2);
+  EXPECT_EQ(num, 12);
+}
+
 TEST(Date, DefaultConstructor)
 {
   Date date;
@@ -38,6 +92,59 @@ TEST(Date, Comparison)
   EXPECT_TRUE(std::is_sorted(sorted.rbegin(), sorted.rend(), std::greater<>()));
 }
 
+TEST(Date, Parse)
+{
+  EXPECT_EQ(Date(std::string_view("2/3/2020"), Date::MMDDYYYY), Date(3, 2, 2020));
+  EXPECT_EQ(Date::TryParse("03/02/2020"), Date(3, 2, 2020));
+  EXPECT_FALSE(Date::TryParse("3/2/2020 "));
+  EXPECT_FALSE(Date::TryParse("3/2/"));
+  EXPECT_FALSE(Date::TryParse("3/-2/2020"));
+  EXPECT_FALSE(Date::TryParse("3/2/2020/1"));
+  EXPECT_FALSE(Date::TryParse("31/13/2020"));
+  EXPECT_FALSE(Date::TryParse(""));
+}
+
+TEST(Date, ToChars)
+{
+  std::array<char, Date::kMaxChars> buffer{};
+  const auto result = Date(25, 12, 2020).ToChars(buffer.data(), buffer.data() + buffer.size(), Date::MMDDYYYY);
+  EXPECT_EQ(result.ec, std::errc());
+  EXPECT_EQ(std::string_view(buffer.data(), result.ptr - buffer.data()), "12/25/2020");
+
+  EXPECT_EQ(Date(1, 2, 2020).ToChars(buffer.data(), buffer.data() + 6).ec, std::errc::value_too_large);
+  EXPECT_EQ(Date(1, 2, 2020).ToChars(buffer.data(), buffer.data() + 4).ec, std::errc::value_too_large);
+  EXPECT_EQ(Date().ToChars(buffer.data(), buffer.data() + buffer.size()).ec, std::errc::invalid_argument);
+}
+
+TEST(Date, Days)
+{
+  static_assert(Date(1, 1, 1970).ToDays() == 0);
+  static_assert(Date::FromDays(18321).ToDays() == 18321);
+  EXPECT_EQ(Date(29, 2, 2020).ToDays(), 18321);
+  EXPECT_EQ(Date(1, 3, 2000).ToDays() - Date(28, 2, 2000).ToDays(), 2);
+  EXPECT_EQ(Date(1, 3, 2090).ToDays() - Date(28, 2, 2090).ToDays(), 1);
+
+  for (int32_t days = 0; days < 365 * 120; ++days) ASSERT_EQ(Date::FromDays(days).ToDays(), days);
+  EXPECT_ANY_THROW(Date::FromDays(-1));
+  EXPECT_ANY_THROW(Date::FromDays(365 * 128));
+}
+
+TEST(Date, Arithmetic)
+{
+  auto date = Date(31, 12, 2019);
+  EXPECT_EQ(++date, Date(1, 1, 2020));
+  EXPECT_EQ(date + 59, Date(29, 2, 2020));
+  EXPECT_EQ(date - 1, Date(31, 12, 2019));
+  EXPECT_EQ(Date(1, 1, 2021) - date, 366);
+
+  date -= 365;
+  EXPECT_EQ(date, Date(1, 1, 2019));
+
+  int32_t count = 0;
+  for (Date day = Date(1, 2, 2021); day < Date(1, 3, 2021); ++day) ++count;
+  EXPECT_EQ(count, 28);
+}
+
 struct DateConstructorInitParams
 {
   std::string str;
@@ -0,0 +1,104 @@
+/**
+ * @file vanguard_test.cc
+ * @author Antony Kellermann
+ * @copyright 2020 Antony Kellermann
+ */
+
+#include "invport/detail/vanguard.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <cstddef>
+#include <string>
+
+using Transaction = inv::TransactionHistory::Transaction;
+
+namespace
+{
+constexpr const char* const kExport =
+    "Account Number,Investment Name,Symbol,Shares,Share Price,Total Value,\n"
+    "12345678,TESLA INC,TSLA,3,400.5,1201.5,\n"
+    "\n"
+    "\n"
+    "Account Number,Trade Date,Settlement Date,Transaction Type,Transaction Description,Investment Name,Symbol,Shares,"
+    "Share Price,Principal Amount,Commissions and Fees,Net Amount,Accrued Interest,Account Type,\n"
+    "12345678,02/03/2020,02/05/2020,Sell,Sell,TESLA INC,TSLA,-1.0000,700.5,700.5,0.01,700.49,0.0,CASH,\r\n"
+    "12345678,01/02/2020,01/06/2020,Buy,Buy,TESLA INC,TSLA,4.0000,400.5,-1602.0,0.0,-1602.0,0.0,CASH,\r\n"
+    "12345678,01/02/2020,01/02/2020,Dividend,Dividend Received,VANGUARD FEDERAL MONEY MARKET,VMFXX,0.0000,1.0,"
+    "0.1,0.0,0.1,0.0,CASH,\r\n";
+}  // namespace
+
+TEST(Vanguard, Parse)
+{
+  const auto path = "/tmp/invport/" + std::to_string(std::rand()) + "vanguard.csv";
+  std::filesystem::create_directories("/tmp/invport");
+  {
+    std::ofstream out(path);
+    out << kExport;
+  }
+
+  const auto th = inv::vanguard::Parse(path);
+  const auto totals = th.GetTotals();
+  ASSERT_EQ(totals.size(), 1);
+  EXPECT_EQ(totals.at(inv::Symbol("TSLA")).quantity, 3);
+  EXPECT_EQ(th.GetAssociatedTransactions(inv::vanguard::kAccountNumberTag, "12345678").size(), 2);
+
+  const auto sells = th[inv::Date(3, 2, 2020)];
+  ASSERT_EQ(sells.size(), 1);
+  const auto* sell = inv::TransactionPool::Find(*sells.begin());
+  EXPECT_EQ(sell->type, Transaction::Type::SELL);
+  EXPECT_EQ(sell->price, 700.5);
+  EXPECT_EQ(sell->fee, 0.01);
+}
+
+TEST(Vanguard, ParseChunks)
+{
+  const auto path = "/tmp/invport/" + std::to_string(std::rand()) + "vanguard.csv";
+  std::filesystem::create_directories("/tmp/invport");
+  {
+    std::ofstream out(path);
+    out << kExport;
+    for (int i = 0; i < 1000; ++i)
+      out << "12345678,01/03/2020,01/06/2020,Buy,Buy,TESLA INC,TSLA,1.0000,400.5,-400.5,0.0,-400.5,0.0,CASH,\r\n";
+  }
+
+  // Chunks this small split rows and sections across threads.
+  for (std::size_t min_chunk_bytes : {1, 7, 64, 4096})
+  {
+    const auto th = inv::vanguard::Parse(path, min_chunk_bytes);
+    const auto totals = th.GetTotals();
+    ASSERT_EQ(totals.size(), 1);
+    EXPECT_EQ(totals.at(inv::Symbol("TSLA")).quantity, 1003);
+    EXPECT_EQ(th.GetAssociatedTransactions(inv::vanguard::kAccountNumberTag, "12345678").size(), 1002);
+    EXPECT_EQ(th[inv::Date(3, 1, 2020)].size(), 1000);
+  }
+}
+
+TEST(Vanguard, ParseValidation)
+{
+  const auto path = "/tmp/invport/" + std::to_string(std::rand()) + "vanguard.csv";
+  std::filesystem::create_directories("/tmp/invport");
+  const std::string header =
+      "Account Number,Trade Date,Settlement Date,Transaction Type,Transaction Description,Investment Name,Symbol,"
+      "Shares,Share Price,Principal Amount,Commissions and Fees,Net Amount,Accrued Interest,Account Type,\n";
+
+  // Account numbers are tagged as numbers, without their leading zeros.
+  {
+    std::ofstream out(path);
+    out << header << "0012345678,01/02/2020,01/06/2020,Buy,Buy,TESLA INC,TSLA,4.0000,400.5,-1602.0,0.0,-1602.0,0.0,"
+                     "CASH,\r\n";
+  }
+  const auto th = inv::vanguard::Parse(path);
+  EXPECT_EQ(th.GetAssociatedTransactions(inv::vanguard::kAccountNumberTag, "12345678").size(), 1);
+  EXPECT_TRUE(th.GetAssociatedTransactions(inv::vanguard::kAccountNumberTag, "0012345678").empty());
+
+  // A settlement date that does not exist fails the import, like an invalid trade date.
+  {
+    std::ofstream out(path);
+    out << header << "12345678,01/02/2020,13/02/2020,Buy,Buy,TESLA INC,TSLA,4.0000,400.5,-1602.0,0.0,-1602.0,0.0,"
+                     "CASH,\r\n";
+  }
+  EXPECT_TRUE(inv::vanguard::Parse(path).GetTotals().empty());
+}
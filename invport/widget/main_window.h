@@ -24,6 +24,8 @@ class MainWindow : public Gtk::ApplicationWindow, private WidgetBase
         transaction_history_(TransactionHistory::Factory()),
         transaction_tab_(GetWidgetDerived<Transactions>(bldr, "transactions_tab_paned", transaction_history_))
   {
+    // The application quits once the window is hidden, so queued flushes have to be written first.
+    signal_hide().connect(sigc::mem_fun(transaction_history_, &TransactionHistory::Sync));
   }
 
  private:
@@ -23,6 +23,7 @@ void Transactions::RemoveTransactionButtonSignalActivate()
     {
       TransactionHistory::TransactionID id = std::strtoull(id_string.c_str(), nullptr, 10);
       transaction_history_.Remove(id);
+      TransactionPool::Release(id);
 
       RefreshAndFlush();
     }
@@ -34,44 +35,17 @@ void Transactions::VanguardFileChooserButtonSignalFileSet()
   const auto path = vanguard_file_chooser_button_.get_filename();
   vanguard_file_chooser_button_.unselect_all();
 
-  auto th = vanguard::Parse(path);
-  for (auto date_iter = th.begin(); date_iter != th.end();)
-  {
-    auto& [new_date, new_trs] = *date_iter;
-    bool increment = true;
-
-    if (const auto date_it = transaction_history_.Find(new_date); date_it != transaction_history_.end())
-    {
-      auto& trs = date_it->second;
-
-      // Make hashtables of duplicate transactions
-      TransactionHistory::MemberwiseTransactionMap<TransactionHistory::TransactionSet> counter;
-      TransactionHistory::MemberwiseTransactionMap<TransactionHistory::TransactionSet> new_counter;
-      for (const auto& tr : trs) counter[tr].insert(tr);
-      for (const auto& tr : new_trs) new_counter[tr].insert(tr);
-
-      // Only insert the difference of duplicates
-      for (const auto& [new_id, new_ids] : new_counter)
-      {
-        const auto& ids = counter[new_id];
-        auto num_duplicate_new_trs = static_cast<int>(ids.size());
+  // Only the rows that were not imported from this export into this history before are parsed.
+  auto& source = import_ledger_.Find(vanguard::GetImporter().GetSchema(), path, transaction_history_.Identity());
+  const auto th = vanguard::Parse(path, source);
 
-        auto it = new_ids.begin();
-        while (num_duplicate_new_trs > 0 && it != new_ids.end())
-        {
-          auto pair = th.Remove(*it);
-          date_iter = pair.first;
-          if (pair.second) increment = false;
-          ++it;
-          --num_duplicate_new_trs;
-        }
-      }
-    }
-    if (increment) ++date_iter;
-  }
-
-  transaction_history_.Merge(th);
+  // Transactions that the history already has, such as those of an overlapping export, are not merged again.
+  for (const auto id : transaction_history_.MergeMissing(th)) TransactionPool::Release(id);
   RefreshAndFlush();
+
+  // The ledger is written after the merged transactions, off this thread, so it never claims rows that the history
+  // on disk does not have.
+  transaction_history_.AfterFlush(import_ledger_.PrepareFlush());
 }
 
 void Transactions::Refresh(bool flush)
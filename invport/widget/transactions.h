@@ -9,6 +9,7 @@
 #include <gtkmm.h>
 
 #include "invport/detail/common.h"
+#include "invport/detail/import_ledger.h"
 #include "invport/detail/transaction_history.h"
 #include "invport/widget/base.h"
 #include "invport/widget/transaction_creator.h"
@@ -58,6 +59,7 @@ class Transactions : public Gtk::Paned, private WidgetBase
   void Refresh(bool flush);
 
   TransactionHistory& transaction_history_;
+  import::Ledger import_ledger_;
 
   TransactionCreator& transaction_creator_;
   Gtk::FileChooserButton& vanguard_file_chooser_button_;